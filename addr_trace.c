@@ -0,0 +1,185 @@
+/*
+   Address traces
+   Description: read byte address traces (lackey, text or binary) into
+   page refs at several page sizes at once. See addr_trace.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "addr_trace.h"
+
+#define ADDR_CHUNK 65536 // addresses per fread() of a binary trace
+
+/**
+ * int parse_page_sizes(const char *list, uint64_t sizes[])
+ *
+ * Parse a comma separated list of page sizes, in bytes with an optional
+ * K, M or G suffix: "4K,64K,2M"
+ *
+ * @return number of sizes, -1 if one is malformed or not a power of 2
+ */
+int parse_page_sizes(const char *list, uint64_t sizes[MAX_PAGE_SIZES])
+{
+	const char *p = list;
+	char *end = NULL;
+	int n = 0;
+	while(*p != '\0')
+	{
+		uint64_t size = strtoull(p, &end, 10);
+		if(end == p || n == MAX_PAGE_SIZES)
+			return -1;
+		switch(toupper((unsigned char)*end))
+		{
+			case 'K': size <<= 10; end++; break;
+			case 'M': size <<= 20; end++; break;
+			case 'G': size <<= 30; end++; break;
+		}
+		if(size == 0 || (size & (size - 1)) != 0 || (*end != ',' && *end != '\0'))
+			return -1;
+		sizes[n++] = size;
+		p = *end == ',' ? end + 1 : end;
+	}
+	return n;
+}
+
+const char *page_size_str(uint64_t bytes, char *buf, size_t len)
+{
+	if(bytes >= (1 << 30) && bytes % (1 << 30) == 0)
+		snprintf(buf, len, "%lluG", (unsigned long long)(bytes >> 30));
+	else if(bytes >= (1 << 20) && bytes % (1 << 20) == 0)
+		snprintf(buf, len, "%lluM", (unsigned long long)(bytes >> 20));
+	else if(bytes >= (1 << 10) && bytes % (1 << 10) == 0)
+		snprintf(buf, len, "%lluK", (unsigned long long)(bytes >> 10));
+	else
+		snprintf(buf, len, "%llu", (unsigned long long)bytes);
+	return buf;
+}
+
+int addr_trace_init(Addr_Trace *at, uint64_t page_size)
+{
+	memset(at, 0, sizeof(*at));
+	at->page_size = page_size;
+	while(((uint64_t)1 << at->shift) < page_size)
+		at->shift++;
+	return page_ids_init(&at->ids, 1024);
+}
+
+void addr_trace_free(Addr_Trace *at)
+{
+	free(at->refs);
+	page_ids_free(&at->ids);
+	at->refs = NULL;
+	at->len = at->cap = 0;
+}
+
+/*
+ * add a ref to page unless it repeats the last one
+ */
+static void add_page(Addr_Trace *at, uint64_t page)
+{
+	if(at->len > 0 && at->last == page)
+		return;
+	if(at->len == at->cap)
+	{
+		at->cap = at->cap ? at->cap * 2 : 4096;
+		at->refs = realloc(at->refs, at->cap * sizeof(int));
+		if(at->refs == NULL)
+		{
+			perror("addr_trace_read()");
+			exit(-1);
+		}
+	}
+	at->refs[at->len++] = page_ids_intern(&at->ids, page);
+	at->last = page;
+}
+
+/*
+ * one access of size bytes at addr, for every page size
+ */
+static void add_access(Addr_Trace traces[], int n, uint64_t addr, uint64_t size)
+{
+	uint64_t last_byte = size > 1 && addr + (size - 1) > addr ? addr + (size - 1) : addr;
+	uint64_t page = 0;
+	int i = 0;
+	for(i = 0; i < n; i++)
+	{
+		for(page = addr >> traces[i].shift; ; page++)
+		{
+			add_page(&traces[i], page);
+			if(page == last_byte >> traces[i].shift)
+				break;
+		}
+	}
+}
+
+/*
+ * a lackey line "I  0400d7d4,8" or " L 7ff000398,4", or a plain address.
+ * Returns 0 for a line without an access.
+ */
+static int parse_access(const char *line, uint64_t *addr, uint64_t *size)
+{
+	const char *p = line + strspn(line, " \t");
+	char *end = NULL;
+	*size = 1;
+	if((p[0] == 'I' || p[0] == 'L' || p[0] == 'S' || p[0] == 'M') && (p[1] == ' ' || p[1] == '\t'))
+	{ // lackey, address in hex without 0x
+		p += 1 + strspn(p + 1, " \t");
+		*addr = strtoull(p, &end, 16);
+		if(end == p || *end != ',')
+			return 0;
+		*size = strtoull(end + 1, NULL, 10);
+		return 1;
+	}
+	*addr = strtoull(p, &end, p[0] == '0' && (p[1] == 'x' || p[1] == 'X') ? 16 : 10);
+	return end != p;
+}
+
+/**
+ * long addr_trace_read(const char *path, Addr_Trace traces[], int n)
+ *
+ * Read the address trace at path into traces[0..n-1], one per page size,
+ * all in a single pass
+ *
+ * @return number of accesses read, -1 if the file can't be read
+ */
+long addr_trace_read(const char *path, Addr_Trace traces[], int n)
+{
+	FILE *fp = fopen(path, "rb");
+	char line[256];
+	uint64_t *chunk = NULL;
+	uint64_t addr = 0, size = 0;
+	size_t got = 0, i = 0;
+	long accesses = 0;
+	if(fp == NULL)
+		return -1;
+	got = fread(line, 1, sizeof(line), fp);
+	rewind(fp);
+	if(memchr(line, '\0', got) != NULL)
+	{ // binary stream of uint64_t addresses
+		if((chunk = malloc(sizeof(uint64_t) * ADDR_CHUNK)) == NULL)
+		{
+			fclose(fp);
+			return -1;
+		}
+		while((got = fread(chunk, sizeof(uint64_t), ADDR_CHUNK, fp)) > 0)
+		{
+			for(i = 0; i < got; i++)
+				add_access(traces, n, chunk[i], 1);
+			accesses += got;
+		}
+		free(chunk);
+	}
+	else
+	{
+		while(fgets(line, sizeof(line), fp) != NULL)
+		{
+			if(!parse_access(line, &addr, &size))
+				continue;
+			add_access(traces, n, addr, size);
+			accesses++;
+		}
+	}
+	fclose(fp);
+	return accesses;
+}
@@ -0,0 +1,38 @@
+#ifndef ADDR_TRACE_H
+#define ADDR_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "page_ids.h"
+
+/**
+ * Byte address traces from memory access tracers, turned into page refs
+ * for one or more page sizes in a single read of the file. Accepted
+ * formats, told apart by content:
+ * - Valgrind lackey (--trace-mem=yes): "I  0400d7d4,8", " L 7ff000398,4",
+ *   " S ...", " M ...", other lines ("==pid==" banners) are skipped
+ * - text, one address per line, decimal or 0x hex
+ * - binary, a stream of uint64_t addresses in host byte order (any file
+ *   with a NUL byte in its first block)
+ * Consecutive accesses to the same page collapse into one ref, and an
+ * access that straddles a page boundary references both pages.
+ */
+#define MAX_PAGE_SIZES 8
+
+typedef struct Addr_Trace
+{
+	uint64_t page_size; // bytes, a power of 2
+	int shift; // log2(page_size)
+	int *refs; // dense page ids, see Page_Ids
+	size_t len, cap;
+	Page_Ids ids; // page number (address >> shift) -> dense id
+	uint64_t last; // page of the last ref, valid when len > 0
+} Addr_Trace;
+
+int parse_page_sizes(const char *list, uint64_t sizes[MAX_PAGE_SIZES]); // "4K,2M" -> count, -1 if malformed
+const char *page_size_str(uint64_t bytes, char *buf, size_t len); // 2097152 -> "2M"
+int addr_trace_init(Addr_Trace *at, uint64_t page_size); // 0 on success, -1 on allocation failure
+void addr_trace_free(Addr_Trace *at);
+long addr_trace_read(const char *path, Addr_Trace traces[], int n); // accesses read, -1 on error
+
+#endif
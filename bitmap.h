@@ -0,0 +1,60 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Packed bit array, one bit per frame, used for reference bits
+ */
+static inline uint64_t *bitmap_alloc(size_t nbits)
+{
+	return calloc((nbits + 63) / 64, sizeof(uint64_t));
+}
+
+static inline int bitmap_test(const uint64_t *map, size_t i)
+{
+	return (map[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void bitmap_set(uint64_t *map, size_t i)
+{
+	map[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline void bitmap_clear(uint64_t *map, size_t i)
+{
+	map[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
+
+/*
+ * CLOCK sweep: starting at start, find the first bit that is clear,
+ * wrapping around after n bits, and clear every set bit passed on the way.
+ * Works a word (64 frames) at a time. If all n bits are set they are all
+ * cleared and start is returned.
+ */
+static inline int bitmap_sweep(uint64_t *map, int n, int start)
+{
+	int i = start;
+	for(;;)
+	{
+		int w = i >> 6;
+		int end = (w + 1) * 64 < n ? 64 : n - w * 64; // valid bits in this word
+		uint64_t valid = end == 64 ? ~(uint64_t)0 : (((uint64_t)1 << end) - 1);
+		uint64_t from = valid & (~(uint64_t)0 << (i & 63));
+		uint64_t clear = ~map[w] & from;
+		if(clear)
+		{
+			int found = __builtin_ctzll(clear);
+			// give a second chance to everything between i and found
+			map[w] &= ~(from & (((uint64_t)1 << found) - 1));
+			return w * 64 + found;
+		}
+		map[w] &= ~from;
+		i = (w + 1) * 64;
+		if(i >= n)
+			i = 0;
+	}
+}
+
+#endif
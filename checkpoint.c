@@ -0,0 +1,350 @@
+/*
+   Checkpoints
+   Description: save the simulator state to a flat file and mmap it back
+   in to resume or fork a run. See checkpoint.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "policy.h"
+
+#define CHECKPOINT_LABEL 32
+#define CHECKPOINT_SIG_SAMPLES 4096
+
+/*
+ * one algorithm's record, followed by its sections: frame table page,
+ * tick and extra arrays, reference bits, page index keys and vals, and
+ * the policy state, each padded to 8 bytes
+ */
+typedef struct Checkpoint_Algo
+{
+	char label[CHECKPOINT_LABEL];
+	uint64_t bytes; // whole record, header included
+	uint64_t hits, misses, swap_in, swap_out, total_ref_count, evictions;
+	uint64_t faults, series_refs, series_faults, series_evictions;
+	int64_t clock_hand, used;
+	uint32_t map_mask;
+	int32_t map_shift, map_count, pad;
+	uint64_t state_bytes;
+	Algo_Timing timing;
+} Checkpoint_Algo;
+
+static size_t pad8(size_t n)
+{
+	return (n + 7) & ~(size_t)7;
+}
+
+static size_t ref_bits_words(void)
+{
+	return (2 * (size_t)num_frames + 1 + 63) / 64; // see create_algo_data_store()
+}
+
+/**
+ * uint64_t checkpoint_trace_sig()
+ *
+ * FNV-1a over up to CHECKPOINT_SIG_SAMPLES evenly spaced refs and the
+ * trace length, cheap enough for traces of billions of refs
+ */
+uint64_t checkpoint_trace_sig(void)
+{
+	uint64_t h = 14695981039346656037ULL;
+	size_t n = max_page_calls < page_ref_trace_len ? (size_t)max_page_calls : page_ref_trace_len;
+	size_t step = n / CHECKPOINT_SIG_SAMPLES > 0 ? n / CHECKPOINT_SIG_SAMPLES : 1;
+	size_t i = 0;
+	h = (h ^ n) * 1099511628211ULL;
+	for(i = 0; i < n; i += step)
+		h = (h ^ (uint32_t)page_ref_trace[i]) * 1099511628211ULL;
+	return h;
+}
+
+static int write_section(FILE *fp, const void *p, size_t bytes)
+{
+	static const char zeros[8] = {0};
+	if(bytes > 0 && fwrite(p, 1, bytes, fp) != bytes)
+		return -1;
+	if(pad8(bytes) > bytes && fwrite(zeros, 1, pad8(bytes) - bytes, fp) != pad8(bytes) - bytes)
+		return -1;
+	return 0;
+}
+
+static int save_algo(FILE *fp, const Algorithm *algo)
+{
+	const Algorithm_Data *data = algo->data;
+	const Frame_Table *ft = &data->page_table;
+	size_t slots = (size_t)data->page_index.mask + 1;
+	Checkpoint_Algo rec;
+	void *state = NULL;
+	int err = 0;
+	memset(&rec, 0, sizeof(rec));
+	if(data->policy_state != NULL && algo->policy->state_size == NULL)
+	{
+		fprintf(stderr, "[ERR] %s has no state_size() hook, it can't be checkpointed\n",
+				algo->policy->label);
+		return -1;
+	}
+	snprintf(rec.label, sizeof(rec.label), "%s", algo->policy->label);
+	rec.hits = data->hits;
+	rec.misses = data->misses;
+	rec.swap_in = data->swap_in;
+	rec.swap_out = data->swap_out;
+	rec.total_ref_count = data->total_ref_count;
+	rec.evictions = data->evictions;
+	rec.faults = data->faults;
+	rec.series_refs = data->series_refs;
+	rec.series_faults = data->series_faults;
+	rec.series_evictions = data->series_evictions;
+	rec.clock_hand = data->clock_hand;
+	rec.used = ft->used;
+	rec.map_mask = data->page_index.mask;
+	rec.map_shift = data->page_index.shift;
+	rec.map_count = data->page_index.count;
+	rec.state_bytes = data->policy_state != NULL ? algo->policy->state_size(data) : 0;
+	rec.timing = data->timing;
+	rec.bytes = sizeof(rec) + pad8(sizeof(int) * ft->size) + pad8(sizeof(tick_t) * ft->size) +
+		pad8(sizeof(uint32_t) * ft->size) + sizeof(uint64_t) * ref_bits_words() +
+		2 * pad8(sizeof(int) * slots) + pad8(rec.state_bytes);
+
+	if(rec.state_bytes > 0 && algo->policy->state_save != NULL)
+	{ // flatten into a buffer, a single allocation is written as is
+		if((state = malloc(rec.state_bytes)) == NULL)
+			return -1;
+		algo->policy->state_save(data, state);
+	}
+	err = write_section(fp, &rec, sizeof(rec)) ||
+		write_section(fp, ft->page, sizeof(int) * ft->size) ||
+		write_section(fp, ft->tick, sizeof(tick_t) * ft->size) ||
+		write_section(fp, ft->extra, sizeof(uint32_t) * ft->size) ||
+		write_section(fp, data->ref_bits, sizeof(uint64_t) * ref_bits_words()) ||
+		write_section(fp, data->page_index.keys, sizeof(int) * slots) ||
+		write_section(fp, data->page_index.vals, sizeof(int) * slots) ||
+		write_section(fp, state != NULL ? state : data->policy_state, rec.state_bytes);
+	free(state);
+	return err ? -1 : 0;
+}
+
+/**
+ * int checkpoint_save(const char *path, size_t cursor)
+ *
+ * Snapshot every algorithm after cursor refs. The file is written next
+ * to path and renamed over it, so a run killed mid-save keeps the
+ * previous snapshot.
+ *
+ * @return 0 on success, -1 on error
+ */
+int checkpoint_save(const char *path, size_t cursor)
+{
+	char tmp[512];
+	FILE *fp = NULL;
+	Checkpoint_Header hdr;
+	size_t i = 0;
+	int err = 0;
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	if((fp = fopen(tmp, "wb")) == NULL)
+	{
+		perror("checkpoint_save()");
+		return -1;
+	}
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, CHECKPOINT_MAGIC, sizeof(hdr.magic));
+	hdr.version = CHECKPOINT_VERSION;
+	for(i = 0; i < num_algos; i++)
+		hdr.nalgos += algos[i].selected == 1;
+	hdr.num_frames = num_frames;
+	hdr.page_ref_upper_bound = page_ref_upper_bound;
+	hdr.tick_bytes = sizeof(tick_t);
+	hdr.window_size = _window_size;
+	hdr.warmup = _warmup;
+	hdr.measure = _measure;
+	hdr.max_page_calls = max_page_calls;
+	hdr.cursor = cursor;
+	hdr.trace_sig = checkpoint_trace_sig();
+	err = write_section(fp, &hdr, sizeof(hdr));
+	for(i = 0; i < num_algos && !err; i++)
+		if(algos[i].selected == 1)
+			err = save_algo(fp, &algos[i]);
+	if(fclose(fp) != 0 || err || rename(tmp, path) != 0)
+	{
+		perror("checkpoint_save()");
+		remove(tmp);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * copy a section out of the mapped snapshot and step past it
+ */
+static const unsigned char *read_section(const unsigned char *p, void *dst, size_t bytes)
+{
+	memcpy(dst, p, bytes);
+	return p + pad8(bytes);
+}
+
+static void restore_algo(Algorithm *algo, const Checkpoint_Algo *rec)
+{
+	Algorithm_Data *data = algo->data;
+	Frame_Table *ft = &data->page_table;
+	size_t slots = (size_t)rec->map_mask + 1;
+	const unsigned char *p = (const unsigned char *)(rec + 1);
+	data->hits = rec->hits;
+	data->misses = rec->misses;
+	data->swap_in = rec->swap_in;
+	data->swap_out = rec->swap_out;
+	data->total_ref_count = rec->total_ref_count;
+	data->evictions = rec->evictions;
+	data->faults = rec->faults;
+	data->series_refs = rec->series_refs;
+	data->series_faults = rec->series_faults;
+	data->series_evictions = rec->series_evictions;
+	data->clock_hand = rec->clock_hand;
+	data->timing = rec->timing;
+	ft->used = rec->used;
+	p = read_section(p, ft->page, sizeof(int) * ft->size);
+	p = read_section(p, ft->tick, sizeof(tick_t) * ft->size);
+	p = read_section(p, ft->extra, sizeof(uint32_t) * ft->size);
+	p = read_section(p, data->ref_bits, sizeof(uint64_t) * ref_bits_words());
+
+	if(rec->map_mask != data->page_index.mask)
+	{ // the map had grown, take its size
+		page_map_free(&data->page_index);
+		data->page_index.keys = malloc(sizeof(int) * slots);
+		data->page_index.vals = malloc(sizeof(int) * slots);
+		if(data->page_index.keys == NULL || data->page_index.vals == NULL)
+		{
+			perror("checkpoint_restore()");
+			exit(-1);
+		}
+	}
+	data->page_index.mask = rec->map_mask;
+	data->page_index.shift = rec->map_shift;
+	data->page_index.count = rec->map_count;
+	p = read_section(p, data->page_index.keys, sizeof(int) * slots);
+	p = read_section(p, data->page_index.vals, sizeof(int) * slots);
+
+	if(data->policy_state != NULL && algo->policy->destroy != NULL)
+		algo->policy->destroy(data);
+	else
+		free(data->policy_state);
+	data->policy_state = NULL;
+	if(rec->state_bytes == 0)
+		return;
+	if(algo->policy->state_load != NULL)
+	{
+		algo->policy->state_load(data, p);
+		return;
+	}
+	if((data->policy_state = malloc(rec->state_bytes)) == NULL)
+	{
+		perror("checkpoint_restore()");
+		exit(-1);
+	}
+	memcpy(data->policy_state, p, rec->state_bytes);
+	if(algo->policy->relink != NULL)
+		algo->policy->relink(data);
+}
+
+/*
+ * end of the refs counted with --warmup w and --measure m, the refs
+ * after a snapshot's cursor are free to be counted differently
+ */
+static size_t counted_end(long w, long m, size_t cursor)
+{
+	size_t end = m > 0 ? (size_t)(w > 0 ? w : 0) + m : (size_t)max_page_calls;
+	return end < cursor ? end : cursor;
+}
+
+/**
+ * size_t checkpoint_restore(const char *path)
+ *
+ * Map a snapshot and load it into the algorithms of this run, matched by
+ * label. The run must have the same frames, pages and trace, count the
+ * replayed refs the same way (-w, --warmup, and --measure up to the
+ * cursor), and every selected algorithm must have a record.
+ *
+ * @return refs the snapshot had replayed, where the run continues
+ */
+size_t checkpoint_restore(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	const unsigned char *map = NULL, *p = NULL, *end = NULL;
+	const Checkpoint_Header *hdr = NULL;
+	size_t cursor = 0;
+	uint32_t i = 0;
+	size_t j = 0;
+	char restored[MAX_POLICIES] = {0};
+	if(fd == -1 || fstat(fd, &st) != 0)
+	{
+		perror("checkpoint_restore()");
+		exit(-1);
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED || (size_t)st.st_size < sizeof(Checkpoint_Header))
+	{
+		fprintf(stderr, "[ERR] %s: not a checkpoint\n", path);
+		exit(-1);
+	}
+	hdr = (const Checkpoint_Header *)map;
+	if(memcmp(hdr->magic, CHECKPOINT_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != CHECKPOINT_VERSION ||
+			hdr->tick_bytes != sizeof(tick_t))
+	{
+		fprintf(stderr, "[ERR] %s: not a checkpoint of this version or build (SCALE or not)\n", path);
+		exit(-1);
+	}
+	if(hdr->num_frames != num_frames || hdr->page_ref_upper_bound != page_ref_upper_bound ||
+			hdr->max_page_calls != max_page_calls || hdr->trace_sig != checkpoint_trace_sig())
+	{
+		fprintf(stderr, "[ERR] %s was taken with %d frames, %d pages and a %lld ref trace, "
+				"this run doesn't match (or its trace differs)\n", path,
+				hdr->num_frames, hdr->page_ref_upper_bound, (long long)hdr->max_page_calls);
+		exit(-1);
+	}
+	cursor = hdr->cursor;
+	if(hdr->window_size != _window_size || hdr->warmup != _warmup ||
+			counted_end(hdr->warmup, hdr->measure, cursor) != counted_end(_warmup, _measure, cursor))
+	{
+		fprintf(stderr, "[ERR] %s was taken with -w %d --warmup %lld --measure %lld, "
+				"this run would count its refs differently\n", path,
+				hdr->window_size, (long long)hdr->warmup, (long long)hdr->measure);
+		exit(-1);
+	}
+	p = map + pad8(sizeof(*hdr));
+	end = map + st.st_size;
+	for(i = 0; i < hdr->nalgos; i++)
+	{
+		const Checkpoint_Algo *rec = (const Checkpoint_Algo *)p;
+		if(p + sizeof(*rec) > end || p + rec->bytes > end)
+		{
+			fprintf(stderr, "[ERR] %s is truncated\n", path);
+			exit(-1);
+		}
+		for(j = 0; j < num_algos; j++)
+			if(strncmp(rec->label, algos[j].policy->label, CHECKPOINT_LABEL) == 0)
+				break;
+		if(j < num_algos)
+		{
+			restore_algo(&algos[j], rec);
+			restored[j] = 1;
+		}
+		else
+			fprintf(stderr, ">>> %s: no policy %s in this build, skipped\n", path, rec->label);
+		p += rec->bytes;
+	}
+	for(j = 0; j < num_algos; j++)
+	{
+		if(algos[j].selected == 1 && !restored[j])
+		{
+			fprintf(stderr, "[ERR] %s has no %s, it can only resume the algorithms it was taken with\n",
+					path, algos[j].policy->label);
+			exit(-1);
+		}
+	}
+	munmap((void *)map, st.st_size);
+	return cursor;
+}
@@ -0,0 +1,38 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Simulator snapshots for long runs: every algorithm's counters, frame
+ * table, reference bits, page index and policy state, plus the trace
+ * cursor. The file is a header and one record per selected algorithm,
+ * all in host byte order with 8 byte aligned sections, so a restore is
+ * an mmap() and a memcpy() per section. The trace itself is not saved:
+ * the restoring run must load or generate the same trace (same -t file,
+ * or same --seed and options), which a sampled signature checks.
+ */
+#define CHECKPOINT_MAGIC "PGSIMCK1"
+#define CHECKPOINT_VERSION 3
+
+typedef struct Checkpoint_Header
+{
+	char magic[8]; // CHECKPOINT_MAGIC, not NUL terminated
+	uint32_t version;
+	uint32_t nalgos; // records that follow
+	int32_t num_frames;
+	int32_t page_ref_upper_bound;
+	int32_t tick_bytes; // sizeof(tick_t), 8 in a SCALE build
+	int32_t window_size; // -w, with warmup and measure what the counted refs were
+	int64_t warmup, measure;
+	int64_t max_page_calls;
+	uint64_t cursor; // refs already replayed
+	uint64_t trace_sig; // see checkpoint_trace_sig()
+} Checkpoint_Header;
+
+int checkpoint_save(const char *path, size_t cursor); // 0 on success, -1 on error
+size_t checkpoint_restore(const char *path); // returns the cursor, exits on a mismatch
+uint64_t checkpoint_trace_sig(void); // hash of a sample of the trace
+
+#endif
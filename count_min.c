@@ -0,0 +1,152 @@
+/*
+   Count-Min sketch
+   Description: 4 bit Count-Min sketch with a doorkeeper and periodic
+   halving, the frequency filter of W-TinyLFU. See count_min.h.
+ */
+#include <string.h>
+#include "count_min.h"
+
+#define COUNT_MIN_SAMPLE 10 // references per page of capacity between halvings
+
+static uint32_t pow2_at_least(uint32_t n)
+{
+	uint32_t p = 1;
+	while(p < n)
+		p <<= 1;
+	return p;
+}
+
+static uint32_t counters_per_row(int capacity)
+{
+	return pow2_at_least(capacity > 16 ? (uint32_t)capacity : 16);
+}
+
+static uint32_t door_bits(int capacity)
+{
+	return pow2_at_least((uint32_t)(capacity > 0 ? capacity : 1) * COUNT_MIN_SAMPLE);
+}
+
+/* splitmix64 finalizer, the row hashes are derived from its halves */
+static uint64_t count_min_hash(int page)
+{
+	uint64_t h = (uint64_t)(uint32_t)page + 0x9e3779b97f4a7c15ull;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+	return h ^ (h >> 31);
+}
+
+static inline uint32_t count_min_index(uint64_t h, int i, uint32_t mask)
+{
+	return ((uint32_t)h + (uint32_t)i * (uint32_t)(h >> 32)) & mask;
+}
+
+size_t count_min_words(int capacity)
+{
+	return (size_t)COUNT_MIN_DEPTH * counters_per_row(capacity) / 16
+		+ (door_bits(capacity) + 63) / 64;
+}
+
+/**
+ * void count_min_attach(Count_Min *cm, int capacity, uint64_t *words)
+ *
+ * Point the sketch at its words, keeping the counters in them. Used by
+ * count_min_init() and after the sketch and its words were copied.
+ */
+void count_min_attach(Count_Min *cm, int capacity, uint64_t *words)
+{
+	cm->table = words;
+	cm->door = words + (size_t)COUNT_MIN_DEPTH * counters_per_row(capacity) / 16;
+}
+
+/**
+ * void count_min_init(Count_Min *cm, int capacity, uint64_t *words)
+ *
+ * Set up an empty sketch for a cache of capacity pages in words,
+ * which must hold count_min_words(capacity) entries
+ */
+void count_min_init(Count_Min *cm, int capacity, uint64_t *words)
+{
+	uint32_t width = counters_per_row(capacity);
+	uint32_t bits = door_bits(capacity);
+	count_min_attach(cm, capacity, words);
+	cm->width_mask = width - 1;
+	cm->door_mask = bits - 1;
+	cm->additions = 0;
+	cm->sample_size = (capacity > 0 ? capacity : 1) * COUNT_MIN_SAMPLE;
+	memset(words, 0, sizeof(uint64_t) * count_min_words(capacity));
+}
+
+static int count_min_door_test(const Count_Min *cm, uint64_t h)
+{
+	uint32_t a = (uint32_t)(h >> 7) & cm->door_mask;
+	uint32_t b = (uint32_t)(h >> 37) & cm->door_mask;
+	return ((cm->door[a >> 6] >> (a & 63)) & (cm->door[b >> 6] >> (b & 63)) & 1);
+}
+
+static void count_min_door_set(Count_Min *cm, uint64_t h)
+{
+	uint32_t a = (uint32_t)(h >> 7) & cm->door_mask;
+	uint32_t b = (uint32_t)(h >> 37) & cm->door_mask;
+	cm->door[a >> 6] |= (uint64_t)1 << (a & 63);
+	cm->door[b >> 6] |= (uint64_t)1 << (b & 63);
+}
+
+/* halve every counter (4 bits each, 16 to a word) and clear the doorkeeper */
+static void count_min_reset(Count_Min *cm)
+{
+	size_t words = (size_t)COUNT_MIN_DEPTH * (cm->width_mask + 1) / 16;
+	size_t i = 0;
+	for(i = 0; i < words; i++)
+		cm->table[i] = (cm->table[i] >> 1) & 0x7777777777777777ull;
+	memset(cm->door, 0, sizeof(uint64_t) * ((cm->door_mask + 1 + 63) / 64));
+	cm->additions = 0;
+}
+
+/**
+ * void count_min_increment(Count_Min *cm, int page)
+ *
+ * Record a reference to page. Counters saturate at 15.
+ */
+void count_min_increment(Count_Min *cm, int page)
+{
+	uint64_t h = count_min_hash(page);
+	int i = 0;
+	if(++cm->additions >= cm->sample_size)
+		count_min_reset(cm);
+	if(!count_min_door_test(cm, h))
+	{
+		count_min_door_set(cm, h);
+		return;
+	}
+	for(i = 0; i < COUNT_MIN_DEPTH; i++)
+	{
+		uint32_t c = count_min_index(h, i, cm->width_mask);
+		uint64_t *w = &cm->table[(size_t)i * (cm->width_mask + 1) / 16 + (c >> 4)];
+		int shift = (c & 15) * 4;
+		if(((*w >> shift) & 15) != 15)
+			*w += (uint64_t)1 << shift;
+	}
+}
+
+/**
+ * int count_min_estimate(const Count_Min *cm, int page)
+ *
+ * @return estimated recent references to page, smallest of its counters
+ * plus one if the doorkeeper has seen it
+ */
+int count_min_estimate(const Count_Min *cm, int page)
+{
+	uint64_t h = count_min_hash(page);
+	int i = 0, est = 15;
+	if(!count_min_door_test(cm, h))
+		return 0;
+	for(i = 0; i < COUNT_MIN_DEPTH; i++)
+	{
+		uint32_t c = count_min_index(h, i, cm->width_mask);
+		uint64_t w = cm->table[(size_t)i * (cm->width_mask + 1) / 16 + (c >> 4)];
+		int v = (int)((w >> ((c & 15) * 4)) & 15);
+		if(v < est)
+			est = v;
+	}
+	return est + 1;
+}
@@ -0,0 +1,34 @@
+#ifndef COUNT_MIN_H
+#define COUNT_MIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * TinyLFU frequency sketch: a Count-Min sketch of 4 bit counters guarded
+ * by a doorkeeper Bloom filter. The first reference to a page only sets
+ * its doorkeeper bits, so one-hit pages never reach the counters.
+ * After sample_size references every counter is halved and the doorkeeper
+ * is cleared, so the estimate follows recent frequency.
+ * Memory is fixed by the capacity, not by the number of distinct pages.
+ * The words are supplied by the caller (count_min_words() of them).
+ */
+#define COUNT_MIN_DEPTH 4
+
+typedef struct Count_Min
+{
+	uint64_t *table; // COUNT_MIN_DEPTH rows of width counters, 16 per word
+	uint64_t *door; // doorkeeper bits
+	uint32_t width_mask; // counters per row - 1
+	uint32_t door_mask; // doorkeeper bits - 1
+	int additions; // references since the last halving
+	int sample_size;
+} Count_Min;
+
+size_t count_min_words(int capacity); // uint64_t words needed for capacity pages
+void count_min_init(Count_Min *cm, int capacity, uint64_t *words);
+void count_min_attach(Count_Min *cm, int capacity, uint64_t *words); // re-point at copied words
+void count_min_increment(Count_Min *cm, int page);
+int count_min_estimate(const Count_Min *cm, int page); // 0..16
+
+#endif
@@ -0,0 +1,272 @@
+/*
+   Frame table helpers
+   Description: struct-of-arrays page table and the vectorized searches
+   (page lookup, min/max reductions) used for victim selection.
+   AVX2 and SSE4.1 paths are picked at compile time, with a scalar fallback.
+ */
+#include <stdlib.h>
+#include <string.h>
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "frame_table.h"
+
+#define FRAME_TABLE_ALIGN 32
+
+static void *alloc_lanes(int n, size_t width)
+{
+	void *p = NULL;
+	size_t bytes = (size_t)(n > 0 ? n : 1) * width;
+	// round up so the vector loops can never read past an allocation
+	bytes = (bytes + FRAME_TABLE_ALIGN - 1) & ~(size_t)(FRAME_TABLE_ALIGN - 1);
+	if(posix_memalign(&p, FRAME_TABLE_ALIGN, bytes) != 0)
+		return NULL;
+	return p;
+}
+
+/**
+ * int frame_table_init(Frame_Table *ft, int size)
+ *
+ * Allocate a table of size empty frames
+ *
+ * @param ft {Frame_Table*} table to initialize
+ * @param size {int} number of frames
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int frame_table_init(Frame_Table *ft, int size)
+{
+	int i = 0;
+	ft->size = size;
+	ft->used = 0;
+	ft->page = alloc_lanes(size, sizeof(int));
+	ft->tick = alloc_lanes(size, sizeof(tick_t));
+	ft->extra = alloc_lanes(size, sizeof(uint32_t));
+	if(ft->page == NULL || ft->tick == NULL || ft->extra == NULL)
+	{
+		frame_table_free(ft);
+		return -1;
+	}
+	for(i = 0; i < size; i++)
+		ft->page[i] = -1;
+	memset(ft->tick, 0, sizeof(tick_t) * size);
+	memset(ft->extra, 0, sizeof(uint32_t) * size);
+	return 0;
+}
+
+void frame_table_free(Frame_Table *ft)
+{
+	free(ft->page);
+	free(ft->tick);
+	free(ft->extra);
+	ft->page = NULL;
+	ft->tick = NULL;
+	ft->extra = NULL;
+	ft->size = ft->used = 0;
+}
+
+/*
+ * return index of the first element equal to x, -1 if none
+ */
+static int find_eq32(const uint32_t *v, int n, uint32_t x)
+{
+	int i = 0;
+#if defined(__AVX2__)
+	__m256i key = _mm256_set1_epi32((int)x);
+	for(; i + 8 <= n; i += 8)
+	{
+		__m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(v + i)), key);
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+		if(mask)
+			return i + __builtin_ctz(mask);
+	}
+#elif defined(__SSE2__)
+	__m128i key = _mm_set1_epi32((int)x);
+	for(; i + 4 <= n; i += 4)
+	{
+		__m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(v + i)), key);
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+		if(mask)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	for(; i < n; i++)
+		if(v[i] == x)
+			return i;
+	return -1;
+}
+
+/**
+ * int frame_table_find(const Frame_Table *ft, int page)
+ *
+ * Look up the frame holding a page, only the used frames are searched
+ *
+ * @return {int} frame index, -1 if page is not resident
+ */
+int frame_table_find(const Frame_Table *ft, int page)
+{
+	return find_eq32((const uint32_t *)ft->page, ft->used, (uint32_t)page);
+}
+
+/**
+ * int argmin_u32(const uint32_t *v, int n)
+ *
+ * Find the victim of a "smallest wins" scan. Ties go to the lowest index,
+ * same as a strict < comparison walking the frames in order.
+ *
+ * @return {int} index of the minimum, -1 if n < 1
+ */
+int argmin_u32(const uint32_t *v, int n)
+{
+	int i = 0;
+	uint32_t min = UINT32_MAX;
+	if(n < 1)
+		return -1;
+#if defined(__AVX2__)
+	if(n >= 8)
+	{
+		uint32_t lanes[8];
+		__m256i vmin = _mm256_set1_epi32(-1);
+		for(; i + 8 <= n; i += 8)
+			vmin = _mm256_min_epu32(vmin, _mm256_loadu_si256((const __m256i *)(v + i)));
+		_mm256_storeu_si256((__m256i *)lanes, vmin);
+		for(int k = 0; k < 8; k++)
+			if(lanes[k] < min)
+				min = lanes[k];
+	}
+#elif defined(__SSE4_1__)
+	if(n >= 4)
+	{
+		uint32_t lanes[4];
+		__m128i vmin = _mm_set1_epi32(-1);
+		for(; i + 4 <= n; i += 4)
+			vmin = _mm_min_epu32(vmin, _mm_loadu_si128((const __m128i *)(v + i)));
+		_mm_storeu_si128((__m128i *)lanes, vmin);
+		for(int k = 0; k < 4; k++)
+			if(lanes[k] < min)
+				min = lanes[k];
+	}
+#endif
+	for(; i < n; i++)
+		if(v[i] < min)
+			min = v[i];
+	return find_eq32(v, n, min);
+}
+
+/**
+ * int argmax_u32(const uint32_t *v, int n)
+ *
+ * Find the victim of a "largest wins" scan, ties go to the lowest index
+ *
+ * @return {int} index of the maximum, -1 if n < 1
+ */
+int argmax_u32(const uint32_t *v, int n)
+{
+	int i = 0;
+	uint32_t max = 0;
+	if(n < 1)
+		return -1;
+#if defined(__AVX2__)
+	if(n >= 8)
+	{
+		uint32_t lanes[8];
+		__m256i vmax = _mm256_setzero_si256();
+		for(; i + 8 <= n; i += 8)
+			vmax = _mm256_max_epu32(vmax, _mm256_loadu_si256((const __m256i *)(v + i)));
+		_mm256_storeu_si256((__m256i *)lanes, vmax);
+		for(int k = 0; k < 8; k++)
+			if(lanes[k] > max)
+				max = lanes[k];
+	}
+#elif defined(__SSE4_1__)
+	if(n >= 4)
+	{
+		uint32_t lanes[4];
+		__m128i vmax = _mm_setzero_si128();
+		for(; i + 4 <= n; i += 4)
+			vmax = _mm_max_epu32(vmax, _mm_loadu_si128((const __m128i *)(v + i)));
+		_mm_storeu_si128((__m128i *)lanes, vmax);
+		for(int k = 0; k < 4; k++)
+			if(lanes[k] > max)
+				max = lanes[k];
+	}
+#endif
+	for(; i < n; i++)
+		if(v[i] > max)
+			max = v[i];
+	return find_eq32(v, n, max);
+}
+
+#ifdef PAGESIM_SCALE
+/**
+ * int argmin_tick(const tick_t *v, int n)
+ *
+ * argmin_u32() for 64-bit ticks. There's no unsigned 64-bit min before
+ * AVX-512, so this is left to the compiler.
+ *
+ * @return {int} index of the minimum, -1 if n < 1
+ */
+int argmin_tick(const tick_t *v, int n)
+{
+	int i = 0, min = n > 0 ? 0 : -1;
+	for(i = 1; i < n; i++)
+		if(v[i] < v[min])
+			min = i;
+	return min;
+}
+
+int argmax_tick(const tick_t *v, int n)
+{
+	int i = 0, max = n > 0 ? 0 : -1;
+	for(i = 1; i < n; i++)
+		if(v[i] > v[max])
+			max = i;
+	return max;
+}
+#endif
+
+/**
+ * int argmin_decayed_u32(const uint32_t *v, const tick_t *stamp, int n, tick_t now)
+ *
+ * Victim search for counters that are aged lazily: each v[i] was last
+ * written at stamp[i] and has been halved once per tick since, so its
+ * current value is v[i] >> (now - stamp[i]). The shifts are applied in
+ * registers, the arrays are not modified. Ties go to the lowest index.
+ *
+ * @return {int} index of the minimum decayed value, -1 if n < 1
+ */
+int argmin_decayed_u32(const uint32_t *v, const tick_t *stamp, int n, tick_t now)
+{
+	int i = 0;
+	uint32_t min = UINT32_MAX;
+	if(n < 1)
+		return -1;
+#if defined(__AVX2__) && !defined(PAGESIM_SCALE)
+	if(n >= 8)
+	{
+		uint32_t lanes[8];
+		__m256i vmin = _mm256_set1_epi32(-1);
+		__m256i vnow = _mm256_set1_epi32((int)now);
+		for(; i + 8 <= n; i += 8)
+		{
+			__m256i age = _mm256_sub_epi32(vnow, _mm256_loadu_si256((const __m256i *)(stamp + i)));
+			// srlv yields 0 for shift counts above 31, same as decay_u32()
+			__m256i cur = _mm256_srlv_epi32(_mm256_loadu_si256((const __m256i *)(v + i)), age);
+			vmin = _mm256_min_epu32(vmin, cur);
+		}
+		_mm256_storeu_si256((__m256i *)lanes, vmin);
+		for(int k = 0; k < 8; k++)
+			if(lanes[k] < min)
+				min = lanes[k];
+	}
+#endif
+	for(; i < n; i++)
+		if(decay_u32(v[i], now - stamp[i]) < min)
+			min = decay_u32(v[i], now - stamp[i]);
+	for(i = 0; i < n; i++)
+		if(decay_u32(v[i], now - stamp[i]) == min)
+			return i;
+	return -1;
+}
@@ -0,0 +1,48 @@
+#ifndef FRAME_TABLE_H
+#define FRAME_TABLE_H
+
+#include <stdint.h>
+
+/**
+ * Page table stored as parallel arrays (struct-of-arrays) so the
+ * scan-based policies can run their searches as SIMD reductions.
+ */
+#ifdef PAGESIM_SCALE
+typedef uint64_t tick_t; // logical time, the algorithm's reference count, for runs past 2^32 refs
+#else
+typedef uint32_t tick_t; // logical time, the algorithm's reference count
+#endif
+#define TICK_MAX ((tick_t)-1)
+
+typedef struct Frame_Table
+{
+	int *page; // page held by each frame, -1 is empty
+	tick_t *tick; // time added/accessed
+	uint32_t *extra; // extra field for per-algo use
+	int size; // number of frames
+	int used; // frames are filled in index order, [used, size) are empty
+} Frame_Table;
+
+int frame_table_init(Frame_Table *ft, int size); // allocate size empty frames
+void frame_table_free(Frame_Table *ft);
+int frame_table_find(const Frame_Table *ft, int page); // frame holding page, or -1
+int argmin_u32(const uint32_t *v, int n); // first index of the smallest value
+int argmax_u32(const uint32_t *v, int n); // first index of the largest value
+#ifdef PAGESIM_SCALE
+int argmin_tick(const tick_t *v, int n); // first index of the oldest tick
+int argmax_tick(const tick_t *v, int n); // first index of the newest tick
+#else
+static inline int argmin_tick(const tick_t *v, int n) { return argmin_u32(v, n); }
+static inline int argmax_tick(const tick_t *v, int n) { return argmax_u32(v, n); }
+#endif
+int argmin_decayed_u32(const uint32_t *v, const tick_t *stamp, int n, tick_t now); // argmin of v >> (now - stamp)
+
+/*
+ * value of a counter halved once per tick since it was stamped
+ */
+static inline uint32_t decay_u32(uint32_t v, tick_t age)
+{
+	return age >= 32 ? 0 : v >> age;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef NODE_LIST_H
+#define NODE_LIST_H
+
+/**
+ * Doubly linked lists over array indices. Policies keep their entries in
+ * flat arrays (page, frame, links...) and a Node_List only records the
+ * ends, so a node can sit on several lists through different link arrays
+ * and moving it is O(1) with no allocation.
+ * head is the most recent end (MRU / newest), tail the oldest.
+ */
+typedef struct Node_List
+{
+	int head, tail; // -1 when empty
+	int len;
+} Node_List;
+
+static inline void node_list_init(Node_List *l)
+{
+	l->head = l->tail = -1;
+	l->len = 0;
+}
+
+static inline void node_list_push_head(Node_List *l, int *next, int *prev, int n)
+{
+	prev[n] = -1;
+	next[n] = l->head;
+	if(l->head != -1)
+		prev[l->head] = n;
+	else
+		l->tail = n;
+	l->head = n;
+	l->len++;
+}
+
+static inline void node_list_remove(Node_List *l, int *next, int *prev, int n)
+{
+	if(prev[n] != -1)
+		next[prev[n]] = next[n];
+	else
+		l->head = next[n];
+	if(next[n] != -1)
+		prev[next[n]] = prev[n];
+	else
+		l->tail = prev[n];
+	next[n] = prev[n] = -1;
+	l->len--;
+}
+
+static inline int node_list_pop_tail(Node_List *l, int *next, int *prev)
+{
+	int n = l->tail;
+	if(n != -1)
+		node_list_remove(l, next, prev, n);
+	return n;
+}
+
+static inline void node_list_move_head(Node_List *l, int *next, int *prev, int n)
+{
+	if(l->head == n)
+		return;
+	node_list_remove(l, next, prev, n);
+	node_list_push_head(l, next, prev, n);
+}
+
+#endif
@@ -0,0 +1,143 @@
+/*
+   Page ids
+   Description: page address -> dense page id map used when loading
+   traces. See page_ids.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "page_ids.h"
+
+static uint32_t page_ids_slot(const Page_Ids *ids, uint64_t page)
+{
+	return (uint32_t)((page * 0x9e3779b97f4a7c15ULL) >> ids->shift);
+}
+
+static int page_ids_alloc(Page_Ids *ids, uint32_t slots)
+{
+	int bits = 0;
+	while((1u << bits) < slots)
+		bits++;
+	ids->keys = malloc(sizeof(uint64_t) * slots);
+	ids->vals = malloc(sizeof(int) * slots);
+	if(ids->keys == NULL || ids->vals == NULL)
+	{
+		free(ids->keys);
+		free(ids->vals);
+		return -1;
+	}
+	memset(ids->vals, 0xff, sizeof(int) * slots);
+	ids->mask = slots - 1;
+	ids->shift = 64 - bits;
+	return 0;
+}
+
+/**
+ * int page_ids_init(Page_Ids *ids, int capacity)
+ *
+ * Create an empty map sized for capacity pages. It grows past that.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int page_ids_init(Page_Ids *ids, int capacity)
+{
+	uint32_t slots = 8;
+	while(slots < (uint32_t)capacity * 2)
+		slots <<= 1;
+	ids->count = 0;
+	ids->cap = slots / 2;
+	ids->pages = malloc(sizeof(uint64_t) * ids->cap);
+	if(ids->pages == NULL)
+		return -1;
+	if(page_ids_alloc(ids, slots) != 0)
+	{
+		free(ids->pages);
+		return -1;
+	}
+	return 0;
+}
+
+void page_ids_free(Page_Ids *ids)
+{
+	free(ids->keys);
+	free(ids->vals);
+	free(ids->pages);
+	ids->keys = ids->pages = NULL;
+	ids->vals = NULL;
+	ids->count = 0;
+}
+
+/*
+ * double the slots, every id is rehashed from pages[] in id order
+ */
+static void page_ids_grow(Page_Ids *ids)
+{
+	uint32_t slots = (ids->mask + 1) * 2;
+	uint32_t i = 0;
+	int id = 0;
+	free(ids->keys);
+	free(ids->vals);
+	ids->pages = realloc(ids->pages, sizeof(uint64_t) * slots / 2);
+	if(ids->pages == NULL || page_ids_alloc(ids, slots) != 0)
+	{
+		perror("page_ids_grow()");
+		exit(-1);
+	}
+	ids->cap = slots / 2;
+	for(id = 0; id < ids->count; id++)
+	{
+		i = page_ids_slot(ids, ids->pages[id]);
+		while(ids->vals[i] != -1)
+			i = (i + 1) & ids->mask;
+		ids->keys[i] = ids->pages[id];
+		ids->vals[i] = id;
+	}
+}
+
+/**
+ * int page_ids_intern(Page_Ids *ids, uint64_t page)
+ *
+ * @param page {uint64_t} page address, any value
+ * @return dense id of page, the next free one if page wasn't seen before
+ */
+int page_ids_intern(Page_Ids *ids, uint64_t page)
+{
+	uint32_t i = page_ids_slot(ids, page);
+	while(ids->vals[i] != -1)
+	{
+		if(ids->keys[i] == page)
+			return ids->vals[i];
+		i = (i + 1) & ids->mask;
+	}
+	if(ids->count == INT32_MAX)
+	{
+		fprintf(stderr, "[ERR] more than %d distinct pages\n", INT32_MAX);
+		exit(-1);
+	}
+	if(ids->count == ids->cap)
+	{
+		page_ids_grow(ids);
+		return page_ids_intern(ids, page);
+	}
+	ids->keys[i] = page;
+	ids->vals[i] = ids->count;
+	ids->pages[ids->count] = page;
+	return ids->count++;
+}
+
+/**
+ * int page_ids_find(const Page_Ids *ids, uint64_t page)
+ *
+ * @return dense id of page, -1 if it was never interned
+ */
+int page_ids_find(const Page_Ids *ids, uint64_t page)
+{
+	uint32_t i = page_ids_slot(ids, page);
+	while(ids->vals[i] != -1)
+	{
+		if(ids->keys[i] == page)
+			return ids->vals[i];
+		i = (i + 1) & ids->mask;
+	}
+	return -1;
+}
@@ -0,0 +1,28 @@
+#ifndef PAGE_IDS_H
+#define PAGE_IDS_H
+
+#include <stdint.h>
+
+/**
+ * Page address -> dense id map for loading traces. Real traces carry
+ * sparse 64-bit page addresses, the simulator indexes arrays by page
+ * number, so every distinct address gets the next id 0..count-1 in order
+ * of first reference. Open addressing with linear probing, never deletes.
+ */
+typedef struct Page_Ids
+{
+	uint64_t *keys; // page addresses
+	int *vals; // dense ids, -1 is an empty slot
+	uint64_t *pages; // dense id -> page address
+	uint32_t mask; // slots - 1, slots is a power of 2
+	int shift; // 64 - log2(slots), for the multiplicative hash
+	int count; // ids handed out
+	int cap; // room in pages
+} Page_Ids;
+
+int page_ids_init(Page_Ids *ids, int capacity); // 0 on success, -1 on allocation failure
+void page_ids_free(Page_Ids *ids);
+int page_ids_intern(Page_Ids *ids, uint64_t page); // id of page, a new one on first sight
+int page_ids_find(const Page_Ids *ids, uint64_t page); // id of page, -1 if never interned
+
+#endif
@@ -0,0 +1,139 @@
+/*
+   Page map
+   Description: page number -> index hash map used for O(1) page table
+   lookups. See page_map.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "page_map.h"
+
+static int page_map_alloc(Page_Map *map, int capacity)
+{
+	uint32_t slots = 8;
+	int bits = 3;
+	while(slots < (uint32_t)capacity * 2)
+	{
+		slots <<= 1;
+		bits++;
+	}
+	map->keys = malloc(sizeof(int) * slots);
+	map->vals = malloc(sizeof(int) * slots);
+	if(map->keys == NULL || map->vals == NULL)
+	{
+		free(map->keys);
+		free(map->vals);
+		return -1;
+	}
+	map->mask = slots - 1;
+	map->shift = 32 - bits;
+	map->count = 0;
+	memset(map->keys, 0xff, sizeof(int) * slots);
+	return 0;
+}
+
+/**
+ * int page_map_init(Page_Map *map, int capacity)
+ *
+ * Create an empty map sized for capacity entries. The map grows if more
+ * are inserted.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int page_map_init(Page_Map *map, int capacity)
+{
+	return page_map_alloc(map, capacity > 0 ? capacity : 1);
+}
+
+void page_map_free(Page_Map *map)
+{
+	free(map->keys);
+	free(map->vals);
+	map->keys = map->vals = NULL;
+	map->count = 0;
+}
+
+void page_map_clear(Page_Map *map)
+{
+	memset(map->keys, 0xff, sizeof(int) * (map->mask + 1));
+	map->count = 0;
+}
+
+static void page_map_grow(Page_Map *map)
+{
+	Page_Map bigger;
+	uint32_t i = 0;
+	if(page_map_alloc(&bigger, (int)(map->mask + 1)) != 0)
+	{
+		perror("page_map_grow()");
+		exit(-1);
+	}
+	for(i = 0; i <= map->mask; i++)
+		if(map->keys[i] != -1)
+			page_map_put(&bigger, map->keys[i], map->vals[i]);
+	page_map_free(map);
+	*map = bigger;
+}
+
+/**
+ * void page_map_put(Page_Map *map, int page, int val)
+ *
+ * Insert page or overwrite its value
+ *
+ * @param page {int} page number, must not be -1
+ * @param val {int} value to store
+ */
+void page_map_put(Page_Map *map, int page, int val)
+{
+	uint32_t i = 0;
+	if((uint32_t)(map->count + 1) * 2 > map->mask + 1)
+		page_map_grow(map);
+	i = page_map_slot(map, page);
+	while(map->keys[i] != -1)
+	{
+		if(map->keys[i] == page)
+		{
+			map->vals[i] = val;
+			return;
+		}
+		i = (i + 1) & map->mask;
+	}
+	map->keys[i] = page;
+	map->vals[i] = val;
+	map->count++;
+}
+
+/**
+ * void page_map_del(Page_Map *map, int page)
+ *
+ * Remove page if present. Entries after the hole are shifted back so every
+ * key stays reachable from its home slot without tombstones.
+ */
+void page_map_del(Page_Map *map, int page)
+{
+	uint32_t i = page_map_slot(map, page);
+	uint32_t j = 0, home = 0;
+	while(map->keys[i] != page)
+	{
+		if(map->keys[i] == -1)
+			return;
+		i = (i + 1) & map->mask;
+	}
+	map->count--;
+	j = i;
+	for(;;)
+	{
+		map->keys[i] = -1;
+		do
+		{
+			j = (j + 1) & map->mask;
+			if(map->keys[j] == -1)
+				return;
+			home = page_map_slot(map, map->keys[j]);
+			// keep going while home lies cyclically in (i, j]
+		} while(i <= j ? (i < home && home <= j) : (i < home || home <= j));
+		map->keys[i] = map->keys[j];
+		map->vals[i] = map->vals[j];
+		i = j;
+	}
+}
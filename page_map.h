@@ -0,0 +1,48 @@
+#ifndef PAGE_MAP_H
+#define PAGE_MAP_H
+
+#include <stdint.h>
+
+/**
+ * Open addressing hash map from page number to a small integer
+ * (frame or node index), for O(1) residency lookups.
+ * Linear probing with backward-shift deletion, so there are no tombstones
+ * and lookups stay short under the constant insert/delete churn of a
+ * page table.
+ */
+typedef struct Page_Map
+{
+	int *keys; // page numbers, -1 is an empty slot
+	int *vals;
+	uint32_t mask; // slots - 1, slots is a power of 2
+	int shift; // 32 - log2(slots), for the multiplicative hash
+	int count;
+} Page_Map;
+
+int page_map_init(Page_Map *map, int capacity); // room for capacity entries at <= 50% load
+void page_map_free(Page_Map *map);
+void page_map_clear(Page_Map *map);
+void page_map_put(Page_Map *map, int page, int val);
+void page_map_del(Page_Map *map, int page);
+
+static inline uint32_t page_map_slot(const Page_Map *map, int page)
+{
+	return ((uint32_t)page * 2654435769u) >> map->shift;
+}
+
+/*
+ * return value stored for page, -1 if page is not in the map
+ */
+static inline int page_map_get(const Page_Map *map, int page)
+{
+	uint32_t i = page_map_slot(map, page);
+	while(map->keys[i] != -1)
+	{
+		if(map->keys[i] == page)
+			return map->vals[i];
+		i = (i + 1) & map->mask;
+	}
+	return -1;
+}
+
+#endif
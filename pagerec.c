@@ -0,0 +1,303 @@
+/*
+   Page touch recorder
+   Description: record the pages a workload touches into a pagesim binary
+   trace, by mprotect() and a SIGSEGV handler. See pagerec.h.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include "pagerec.h"
+#include "pagesim.h"
+
+// a watched range, its pages are numbered first..first+pages-1
+typedef struct Rec_Region
+{
+	uintptr_t base;
+	size_t pages;
+	uint32_t first;
+} Rec_Region;
+
+/*
+ * one thread's refs, double buffered: the handler fills one half while
+ * the writer drains the other
+ */
+typedef struct Rec_Buffer
+{
+	int32_t refs[2][PAGEREC_BUF];
+	size_t len[2];
+	atomic_int full[2]; // 1 while a half waits for the writer
+	int cur; // half being filled
+} Rec_Buffer;
+
+static struct
+{
+	FILE *fp;
+	uintptr_t page_size;
+	Rec_Region regions[PAGEREC_MAX_REGIONS];
+	atomic_int nregions;
+	uint32_t next_page; // number of the next region's first page
+	uintptr_t *window; // unprotected pages, oldest at head
+	int window_len, window_head, window_count;
+	atomic_flag window_lock;
+	Rec_Buffer *bufs[PAGEREC_MAX_THREADS];
+	atomic_int nbufs;
+	pthread_t writer;
+	atomic_int running;
+	uint64_t written;
+	struct sigaction old_segv;
+} rec = { .window_lock = ATOMIC_FLAG_INIT };
+
+static __thread Rec_Buffer *thread_buf;
+
+/*
+ * page number of a watched address, -1 if it isn't watched
+ */
+static int64_t watched_page(uintptr_t addr)
+{
+	int n = atomic_load_explicit(&rec.nregions, memory_order_acquire);
+	int i = 0;
+	for(i = 0; i < n; i++)
+		if(addr - rec.regions[i].base < rec.regions[i].pages * rec.page_size)
+			return rec.regions[i].first + (addr - rec.regions[i].base) / rec.page_size;
+	return -1;
+}
+
+/*
+ * the calling thread's buffer, mapped on its first fault: mmap() is
+ * safe in a signal handler, malloc() isn't
+ */
+static Rec_Buffer *get_buffer(void)
+{
+	Rec_Buffer *b = thread_buf;
+	int slot = 0;
+	if(b != NULL)
+		return b;
+	slot = atomic_fetch_add(&rec.nbufs, 1);
+	if(slot >= PAGEREC_MAX_THREADS)
+		return NULL;
+	b = mmap(NULL, sizeof(Rec_Buffer), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(b == MAP_FAILED)
+		return NULL;
+	rec.bufs[slot] = b; // zeroed by mmap, the writer skips it until a half is full
+	thread_buf = b;
+	return b;
+}
+
+static void log_ref(int32_t page)
+{
+	Rec_Buffer *b = get_buffer();
+	if(b == NULL)
+		return;
+	b->refs[b->cur][b->len[b->cur]++] = page;
+	if(b->len[b->cur] < PAGEREC_BUF)
+		return;
+	atomic_store_explicit(&b->full[b->cur], 1, memory_order_release);
+	b->cur ^= 1;
+	while(atomic_load_explicit(&b->full[b->cur], memory_order_acquire))
+		sched_yield(); // the writer is a whole buffer behind
+	b->len[b->cur] = 0;
+}
+
+/*
+ * let page in and push the oldest page of the window back out
+ */
+static void open_page(uintptr_t page)
+{
+	while(atomic_flag_test_and_set_explicit(&rec.window_lock, memory_order_acquire))
+		;
+	mprotect((void *)page, rec.page_size, PROT_READ | PROT_WRITE);
+	if(rec.window_count == rec.window_len)
+	{
+		mprotect((void *)rec.window[rec.window_head], rec.page_size, PROT_NONE);
+		rec.window[rec.window_head] = page;
+		rec.window_head = (rec.window_head + 1) % rec.window_len;
+	}
+	else
+		rec.window[(rec.window_head + rec.window_count++) % rec.window_len] = page;
+	atomic_flag_clear_explicit(&rec.window_lock, memory_order_release);
+}
+
+static void on_segv(int sig, siginfo_t *si, void *ctx)
+{
+	uintptr_t addr = (uintptr_t)si->si_addr;
+	int64_t page = watched_page(addr);
+	if(page < 0)
+	{ // not ours, hand it on
+		if(rec.old_segv.sa_flags & SA_SIGINFO)
+			rec.old_segv.sa_sigaction(sig, si, ctx);
+		else if(rec.old_segv.sa_handler != SIG_DFL && rec.old_segv.sa_handler != SIG_IGN)
+			rec.old_segv.sa_handler(sig);
+		else
+			signal(SIGSEGV, SIG_DFL); // the access faults again and kills us
+		return;
+	}
+	open_page(addr & ~(rec.page_size - 1));
+	log_ref((int32_t)page);
+}
+
+/*
+ * write every full half, returns the number written
+ */
+static int drain(void)
+{
+	int n = atomic_load(&rec.nbufs);
+	int i = 0, h = 0, drained = 0;
+	for(i = 0; i < n && i < PAGEREC_MAX_THREADS; i++)
+	{
+		Rec_Buffer *b = rec.bufs[i];
+		for(h = 0; b != NULL && h < 2; h++)
+		{
+			if(!atomic_load_explicit(&b->full[h], memory_order_acquire))
+				continue;
+			rec.written += fwrite(b->refs[h], sizeof(int32_t), b->len[h], rec.fp);
+			atomic_store_explicit(&b->full[h], 0, memory_order_release);
+			drained++;
+		}
+	}
+	return drained;
+}
+
+static void *writer_main(void *arg)
+{
+	struct timespec nap = { 0, 1000000 };
+	(void)arg;
+	while(atomic_load(&rec.running))
+		if(drain() == 0)
+			nanosleep(&nap, NULL);
+	drain();
+	return NULL;
+}
+
+/**
+ * int pagerec_start(const char *path, int window)
+ *
+ * Open the trace and install the fault handler. Watch memory with
+ * pagerec_watch() or pagerec_alloc() afterwards.
+ *
+ * @param path {const char*} binary trace to write
+ * @param window {int} pages left unprotected, >= 1
+ *
+ * @return 0 on success, -1 on error
+ */
+int pagerec_start(const char *path, int window)
+{
+	struct sigaction sa;
+	uint64_t count = 0;
+	if(window < 1 || (rec.fp = fopen(path, "wb")) == NULL)
+		return -1;
+	rec.page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+	rec.window = calloc(window, sizeof(uintptr_t));
+	rec.window_len = window;
+	rec.window_head = rec.window_count = 0;
+	rec.next_page = 0;
+	rec.written = 0;
+	atomic_store(&rec.nregions, 0);
+	atomic_store(&rec.nbufs, 0);
+	if(rec.window == NULL ||
+			fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC) - 1, rec.fp) != sizeof(TRACE_MAGIC) - 1 ||
+			fwrite(&count, sizeof(count), 1, rec.fp) != 1) // patched by pagerec_stop()
+	{
+		free(rec.window);
+		fclose(rec.fp);
+		return -1;
+	}
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = on_segv;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	atomic_store(&rec.running, 1);
+	if(sigaction(SIGSEGV, &sa, &rec.old_segv) != 0 ||
+			pthread_create(&rec.writer, NULL, writer_main, NULL) != 0)
+	{
+		free(rec.window);
+		fclose(rec.fp);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * int pagerec_watch(void *addr, size_t len)
+ *
+ * Protect [addr, addr + len) so its touches are recorded. addr must be
+ * page aligned, len is rounded up to whole pages.
+ *
+ * @return 0 on success, -1 if not started, unaligned or out of regions
+ */
+int pagerec_watch(void *addr, size_t len)
+{
+	int n = atomic_load(&rec.nregions);
+	size_t pages = (len + rec.page_size - 1) / rec.page_size;
+	if(rec.fp == NULL || n == PAGEREC_MAX_REGIONS || ((uintptr_t)addr & (rec.page_size - 1)) != 0 ||
+			rec.next_page + pages > INT32_MAX)
+		return -1;
+	rec.regions[n].base = (uintptr_t)addr;
+	rec.regions[n].pages = pages;
+	rec.regions[n].first = rec.next_page;
+	rec.next_page += pages;
+	atomic_store_explicit(&rec.nregions, n + 1, memory_order_release);
+	return mprotect(addr, pages * rec.page_size, PROT_NONE);
+}
+
+void *pagerec_alloc(size_t len)
+{
+	void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(p == MAP_FAILED)
+		return NULL;
+	if(pagerec_watch(p, len) != 0)
+	{
+		munmap(p, len);
+		return NULL;
+	}
+	return p;
+}
+
+/**
+ * long pagerec_stop(void)
+ *
+ * Unprotect the watched memory, restore the old SIGSEGV handler, write
+ * what's left in the buffers and close the trace. The workload's other
+ * threads must not touch watched memory any more.
+ *
+ * @return refs written, -1 on a write error
+ */
+long pagerec_stop(void)
+{
+	int n = atomic_load(&rec.nregions);
+	int i = 0, ok = 0;
+	uint64_t count = 0;
+	if(rec.fp == NULL)
+		return -1;
+	for(i = 0; i < n; i++)
+		mprotect((void *)rec.regions[i].base, rec.regions[i].pages * rec.page_size, PROT_READ | PROT_WRITE);
+	sigaction(SIGSEGV, &rec.old_segv, NULL);
+	atomic_store(&rec.running, 0);
+	pthread_join(rec.writer, NULL);
+	n = atomic_load(&rec.nbufs);
+	for(i = 0; i < n && i < PAGEREC_MAX_THREADS; i++)
+	{ // the halves being filled, the full ones were drained by the writer
+		Rec_Buffer *b = rec.bufs[i];
+		if(b == NULL)
+			continue;
+		rec.written += fwrite(b->refs[b->cur], sizeof(int32_t), b->len[b->cur], rec.fp);
+		munmap(b, sizeof(Rec_Buffer));
+		rec.bufs[i] = NULL;
+	}
+	count = rec.written;
+	ok = fseek(rec.fp, sizeof(TRACE_MAGIC) - 1, SEEK_SET) == 0 &&
+		fwrite(&count, sizeof(count), 1, rec.fp) == 1;
+	ok = fclose(rec.fp) == 0 && ok;
+	rec.fp = NULL;
+	free(rec.window);
+	rec.window = NULL;
+	return ok ? (long)count : -1;
+}
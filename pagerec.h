@@ -0,0 +1,43 @@
+#ifndef PAGEREC_H
+#define PAGEREC_H
+
+#include <stddef.h>
+
+/**
+ * Page touch recorder for local benchmark binaries. Link pagerec.c into
+ * the workload, allocate (or register) the memory to watch, and the
+ * touches are written as a pagesim binary trace (see TRACE_MAGIC) that
+ * replays with -t.
+ *
+ * Watched pages are mprotect()ed and the SIGSEGV handler logs the page,
+ * then unprotects it. Only the last window pages stay unprotected, the
+ * oldest is protected again as a new one comes in, so a touch is recorded
+ * whenever it leaves that window. With window 1 every change of page is
+ * recorded. Larger windows cost fewer faults but drop hits among the
+ * window's pages: LRU with at least window frames still sees every miss.
+ *
+ * The handler only appends to a per-thread buffer. A background thread
+ * writes full buffers, so the workload never waits on I/O. Pages are
+ * numbered from 0 across the watched regions in the order they were
+ * added. The kernel can't fault on a protected page for a system call:
+ * read() into a watched buffer fails with EFAULT, so keep I/O buffers
+ * outside the watched regions.
+ *
+ * Order across threads is only kept to the buffer. Each thread's touches
+ * stay in order, but a multi-threaded trace is the threads' streams cut
+ * into chunks of up to PAGEREC_BUF refs, written in the order the chunks
+ * filled, and the partial ones at pagerec_stop(). A thread that touches
+ * little can have its refs written long after later refs of the others,
+ * so a replay doesn't see the real interleaving a shared cache would.
+ * Record one thread at a time where that matters.
+ */
+#define PAGEREC_BUF 16384 // refs per buffer half, the chunk threads are interleaved at
+#define PAGEREC_MAX_REGIONS 64
+#define PAGEREC_MAX_THREADS 256
+
+int pagerec_start(const char *path, int window); // 0 on success, -1 on error
+int pagerec_watch(void *addr, size_t len); // watch a page aligned region, 0 on success, -1 on error
+void *pagerec_alloc(size_t len); // mmap() and watch len bytes, NULL on error
+long pagerec_stop(void); // stop, flush and close, returns refs written or -1
+
+#endif
@@ -12,8 +12,19 @@ Contributor: Hong-Bin Tsai
 #include <time.h>
 #include <math.h>
 #include <getopt.h>
-#include <sys/queue.h>
-#include "pagesim.h"
+#include <limits.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include "bitmap.h"
+#include "policy.h"
+#include "checkpoint.h"
+#include "page_ids.h"
+#include "addr_trace.h"
+#include "trace_stats.h"
+#include "trace_model.h"
+#include "prefetch.h"
+#include "sweep.h"
 
 
 
@@ -26,7 +37,7 @@ Contributor: Hong-Bin Tsai
  *
  *
  * Wish List:
- * 1. add hotness analysis from real trace.
+ * 1. ~~add hotness analysis from real trace.~~ (--analyze)
  * 2. add distribution of hot pages.
  *
  *
@@ -49,49 +60,103 @@ const double STT_RAM_WRITE_LATENCY = 0.013; // 13ns
  */
 int num_frames = 10; // Number of avaliable pages in page tables
 int page_ref_upper_bound = -1; //2*num_frames Largest page reference
-int max_page_calls = -1;//1000*num_frames; // Max number of page refs to test
+long max_page_calls = -1;//1000*num_frames; // Max number of page refs to test
 int swap_mode=0; // enable swapping (between frame list and victim list)
 int debug_flag = 0; // Debug bool, 1 shows verbose output
 int printrefs = 0; // Print refs bool, 1 shows output after each page ref
 int _print_page_ref_stat =0;
+int _analyze=0; // analyze the trace instead of simulating it, see trace_stats.h
 int _num_x=10;
 time_t _start_time;
 int _num_of_hotpages=-1;
 int _window_size=-1;
+long _warmup=-1; // refs replayed before measuring, -1 = not set (the -w window applies)
+long _measure=-1; // refs measured after the warm-up, -1 = to the end of the trace
 FILE *_fp = NULL; // export page number referenced
+int _export=1; // write EXPORT_FILE, off in the --repeat and --sweep workers
 char EXPORT_FILE[]="page_reference_list.csv";
+const size_t REPLAY_BLOCK = 4096; // refs each algorithm replays before the next one runs
+const size_t TIMING_CHUNK = 256; // refs per timed kernel call, see replay_timed()
 
 int _head_hot=0;
 int _tail_hot=0;
 int _mid_hot=0;
 int _dual_head_hot=0;
 
+int _scan_len=0; // length of sequential scans mixed into generated refs, 0 = none
+int _scan_pct=0; // percentage of generated refs that belong to scans
+int _print_timing=0; // print where each algorithm's time went
+int _perf_counters=0; // also profile with hardware performance counters
+int _interval=0; // refs between time series points, 0 = no time series
+char _series_file[256]={}; // time series CSV, stdout if empty
+double _zipf_s=0; // Zipf exponent of generated refs, 0 = uniform/hot pages
+unsigned int _seed=0; // srand() seed, taken from the clock unless _seed_set
+int _seed_set=0;
+char _save_trace_file[256]={}; // write the refs here, binary if it ends in ".bin"
+char _stats_file[256]={}; // CSV of the summaries and timings, none if empty
+char _checkpoint_file[256]={}; // snapshot of the simulator state, none if empty
+long _checkpoint_every=0; // refs between snapshots, 0 = only at the end of the run
+char _restore_file[256]={}; // snapshot to resume from, none if empty
+char _addr_trace_file[256]={}; // byte address trace, replaces -t, see addr_trace.h
+char _page_sizes[128]="4K"; // page sizes to turn --addr_trace addresses into pages at
+char _fit_model_file[256]={}; // write a model of the trace here, see trace_model.h
+char _model_file[256]={}; // generate the refs from this model instead
+int _gen_threads=0; // threads generating from --model, 0 = one per CPU
+int _analyze_threads=0; // threads for --analyze, 0 = one per CPU
+int _prefetch=PREFETCH_OFF; // readahead in front of the policies, see prefetch.h
+int _prefetch_n=4; // its degree N
+int _repeat=1; // runs with seeds _seed, _seed + 1... reported as mean and CI, see repeat_runs()
+int _jobs=0; // --repeat runs or --sweep points at a time, 0 = one per CPU
+char _sweep_spec[512]={}; // --sweep grid, none if empty, see sweep.h
+int _shard_index=0, _shard_count=1; // --shard i/N: the sweep points this run takes
+char _sweep_file[256]={}; // --sweep results, stdout if empty
+int _merge=0; // merge the sweep files given as arguments instead of simulating
+static char run_args[1024]; // the options, without those a --shard may change
+
 /**
- * Array of algorithm functions that can be enabled
+ * Registered policies, sorted by order, see policy_register()
  */
-Algorithm algos[11] = { {"OPTIMAL", &OPTIMAL, 0, NULL},
-                       {"RANDOM", &RANDOM, 0, NULL},
-                       {"FIFO", &FIFO, 0, NULL},
-                       {"LRU", &LRU, 0, NULL},
-                       {"CLOCK", &CLOCK, 0, NULL},
-                       {"NFU", &NFU, 0, NULL},
-                       {"AGING", &AGING, 0, NULL},
-                       {"LOG", &LOG, 0, NULL},
-                       {"LOG_NOWIN", &LOG_NOWIN, 0, NULL},
-                       {"LRU2", &LRU2, 0, NULL},
-                       {"LRU3", &LRU3, 0, NULL}
-};
+Algorithm algos[MAX_POLICIES];
 
 /**
  * Runtime variables, don't touch
  */
-int counter = 0; // "Time" as number of loops calling page_refs 0..._num_refs (used as i in for loop)
+size_t counter = 0; // "Time" as number of loops calling page_refs 0..._num_refs (used as i in for loop)
 int last_page_ref = -1; // Last ref
-size_t num_algos = 0; // Number of algorithms in algos, calculated in init()
+size_t resume_at = 0; // refs a --restore snapshot had replayed, the run picks up there
+size_t num_algos = 0; // Number of algorithms in algos, counted by policy_register()
+int *page_ref_trace = NULL; // page refs to replay, then OPTIMAL's look-ahead padding
+size_t page_ref_trace_len = 0;
+static size_t page_ref_trace_cap = 0;
+static uint64_t *hot_map = NULL; // bit per page, set for the hot pages
+static double *zipf_cdf = NULL; // P(page <= i) for the Zipf generator
+static uint64_t now_ns(void);
+static void create_algos(void);
+static FILE *series_fp = NULL; // time series output, see series_point()
+static void open_series(void);
+static Perf_Counters perf; // opened by init() with --perf, perf.n == 0 otherwise
+static uint64_t loop_perf[PERF_NUM_COUNTERS]; // counters over the whole event loop
+static uint64_t trace_ns = 0; // time to generate or load the trace, without OPTIMAL's padding
+static const char *trace_source = "generated";
+static Page_Ids trace_ids; // -t page addresses and their dense ids, see read_page_refs()
+static int trace_renumbered = 0; // 1 if the -t pages were replaced by dense ids
+static Addr_Trace addr_traces[MAX_PAGE_SIZES]; // --addr_trace pages per page size, moved out as they run
+static int num_page_sizes = 0;
+static int page_size_run = -1; // addr_traces[] entry being simulated, -1 without --addr_trace
+static long addr_accesses = 0; // addresses read from --addr_trace
+static int base_frames = 0; // -f, the frames at the first page size
+static int base_page_bound = -1; // -p as given
 int *optimum_find_test;
-int _num_refs = 0; // Number of page refs in page_refs list
+long _num_refs = 0; // Number of page refs generated
 char _trace_file[256]={};
 
+enum { OPT_SCAN = 256, OPT_SCAN_PCT, OPT_STATS_FILE, OPT_ZIPF, OPT_SEED, OPT_SAVE_TRACE,
+	OPT_INTERVAL, OPT_SERIES_FILE, OPT_WARMUP, OPT_MEASURE,
+	OPT_CHECKPOINT, OPT_CHECKPOINT_EVERY, OPT_RESTORE, OPT_ADDR_TRACE, OPT_PAGE_SIZE,
+	OPT_FIT_MODEL, OPT_MODEL, OPT_GEN_THREADS, OPT_PREFETCH, OPT_PREFETCH_N,
+	OPT_REPEAT, OPT_JOBS, OPT_SWEEP, OPT_SHARD, OPT_SWEEP_FILE,
+	OPT_ANALYZE_THREADS }; // long options without a short form
+
 static struct option long_options[] = {
 	{"algo", required_argument, 0, 'a'},
 	{"multi", required_argument, 0, 'x'},
@@ -99,12 +164,93 @@ static struct option long_options[] = {
 	{"dist_page", required_argument, 0, 'p'},
 	{"hotness", required_argument, 0, 'h'},
 	{"ref_stat", no_argument, &_print_page_ref_stat, 1},
+	{"analyze", no_argument, &_analyze, 1},
+	{"analyze_threads", required_argument, 0, OPT_ANALYZE_THREADS},
 	{"window", required_argument, 0, 'w'},
 	{"verbose", no_argument, &printrefs, 1},
 	{"debug", no_argument, &debug_flag, 1},
+	{"scan", required_argument, 0, OPT_SCAN},
+	{"scan_pct", required_argument, 0, OPT_SCAN_PCT},
+	{"timing", no_argument, &_print_timing, 1},
+	{"perf", no_argument, &_perf_counters, 1},
+	{"stats_file", required_argument, 0, OPT_STATS_FILE},
+	{"zipf", required_argument, 0, OPT_ZIPF},
+	{"seed", required_argument, 0, OPT_SEED},
+	{"save_trace", required_argument, 0, OPT_SAVE_TRACE},
+	{"interval", required_argument, 0, OPT_INTERVAL},
+	{"series_file", required_argument, 0, OPT_SERIES_FILE},
+	{"warmup", required_argument, 0, OPT_WARMUP},
+	{"measure", required_argument, 0, OPT_MEASURE},
+	{"checkpoint", required_argument, 0, OPT_CHECKPOINT},
+	{"checkpoint_every", required_argument, 0, OPT_CHECKPOINT_EVERY},
+	{"restore", required_argument, 0, OPT_RESTORE},
+	{"addr_trace", required_argument, 0, OPT_ADDR_TRACE},
+	{"page_size", required_argument, 0, OPT_PAGE_SIZE},
+	{"fit_model", required_argument, 0, OPT_FIT_MODEL},
+	{"model", required_argument, 0, OPT_MODEL},
+	{"gen_threads", required_argument, 0, OPT_GEN_THREADS},
+	{"prefetch", required_argument, 0, OPT_PREFETCH},
+	{"prefetch_n", required_argument, 0, OPT_PREFETCH_N},
+	{"repeat", required_argument, 0, OPT_REPEAT},
+	{"jobs", required_argument, 0, OPT_JOBS},
+	{"sweep", required_argument, 0, OPT_SWEEP},
+	{"shard", required_argument, 0, OPT_SHARD},
+	{"sweep_file", required_argument, 0, OPT_SWEEP_FILE},
+	{"merge", no_argument, &_merge, 1},
 	{0, 0, 0, 0}
 };
 
+/*
+ * the options into run_args for a --sweep file's header, leaving out
+ * those that don't change the results: --sweep is a line of its own,
+ * and --shard, --sweep_file and --jobs differ between the shards
+ */
+static void args_string(int argc, char *argv[])
+{
+        static const char *skip[] = { "--sweep", "--shard", "--sweep_file", "--jobs" };
+        size_t len = 0, k = 0, n = 0;
+        int i = 0, skipped = 0;
+        for(i = 1; i < argc; i++)
+        {
+                for(k = 0, skipped = 0; k < sizeof(skip) / sizeof(skip[0]) && !skipped; k++)
+                {
+                        n = strlen(skip[k]);
+                        if(strncmp(argv[i], skip[k], n) == 0 && (argv[i][n] == '\0' || argv[i][n] == '='))
+                        {
+                                skipped = 1;
+                                if(argv[i][n] == '\0')
+                                        i++; // and its value
+                        }
+                }
+                if(!skipped && i < argc && len < sizeof(run_args))
+                        len += snprintf(run_args + len, sizeof(run_args) - len, " %s", argv[i]);
+        }
+}
+
+/*
+ * --merge: the sweep files in paths joined into one, to --sweep_file or
+ * stdout, see sweep_merge()
+ */
+static int merge_sweep_files(int n, char **paths)
+{
+        FILE *fp = stdout;
+        int err = 0;
+        if(n < 1)
+        {
+                fprintf(stderr, "[ERR] --merge takes the sweep files to merge\n");
+                exit(-1);
+        }
+        if(strlen(_sweep_file) > 0 && (fp = fopen(_sweep_file, "w")) == NULL)
+        {
+                fprintf(stderr, "[ERR] cannot write %s\n", _sweep_file);
+                exit(-1);
+        }
+        err = sweep_merge(fp, paths, n);
+        if(fp != stdout)
+                fclose(fp);
+        return err == 0 ? 0 : -1;
+}
+
 /**
  * int main(int argc, char *argv[])
  *
@@ -123,11 +269,10 @@ int main ( int argc, char *argv[] )
 		int i=0;
 		char* token;
 		char algo_str[128]={0};
-		char delim[2]={0};
-		delim[0]=' ';
-		delim[1]=',';
+		const char delim[]=" ,";
 
 
+        args_string(argc, argv);
         while((opt = getopt_long(argc, argv, "a:f:w:vdsrx:p:h:t:HTMD", long_options, &long_index)) != -1)
         {
 
@@ -138,27 +283,17 @@ int main ( int argc, char *argv[] )
 					token = strtok(algo_str, delim);
 					while(token)
 					{
-						if(strcmp(token, "LRU") == 0)
-							algos[3].selected = 1;
-						else if(strcmp(token, "LOG") == 0)
-							algos[7].selected = 1;
-						else if(strcmp(token, "CLOCK") == 0)
-							algos[4].selected = 1;
-						else if(strcmp(token, "NFU") == 0)
-							algos[5].selected = 1;
-						else if(strcmp(token, "AGING") == 0)
-							algos[6].selected = 1;
-						else if(strcmp(token, "RANDOM") == 0)
-							algos[1].selected = 1;
-						else if(strcmp(token, "FIFO") ==0)
-							algos[2].selected = 1;
-						else if(strcmp(token, "OPT") ==0)
-							algos[0].selected = 1;
-						else if(strcmp(token, "LRU2") ==0)
-							algos[9].selected = 1;
-						else if(strcmp(token, "LRU3") ==0)
-							algos[10].selected = 1;
-						else
+						for(i=0; i<num_algos; i++)
+						{
+							const Policy *policy = algos[i].policy;
+							if(strcmp(token, policy->label) == 0 ||
+									(policy->alias != NULL && strcmp(token, policy->alias) == 0))
+							{
+								algos[i].selected = 1;
+								break;
+							}
+						}
+						if(i == num_algos)
 							fprintf(stderr, "unrecognized or unsupported algorithm: %s\n", token);
 						token = strtok(0, delim);
 					}
@@ -227,6 +362,138 @@ int main ( int argc, char *argv[] )
 				case 'D':
 					_dual_head_hot=1;
 					break;
+				case OPT_SCAN:
+					_scan_len=atoi(optarg);
+					break;
+				case OPT_SCAN_PCT:
+					_scan_pct=atoi(optarg);
+					if(_scan_pct < 0 || _scan_pct > 100)
+					{
+						fprintf(stderr, "[ERR] --scan_pct takes 0..100\n");
+						exit(-1);
+					}
+					break;
+				case OPT_STATS_FILE:
+					snprintf(_stats_file, sizeof(_stats_file), "%s", optarg);
+					break;
+				case OPT_ZIPF:
+					_zipf_s = atof(optarg);
+					if(_zipf_s <= 0)
+					{
+						fprintf(stderr, "[ERR] --zipf takes an exponent > 0\n");
+						exit(-1);
+					}
+					break;
+				case OPT_SEED:
+					_seed = (unsigned int)strtoul(optarg, NULL, 10);
+					_seed_set = 1;
+					break;
+				case OPT_SAVE_TRACE:
+					snprintf(_save_trace_file, sizeof(_save_trace_file), "%s", optarg);
+					break;
+				case OPT_INTERVAL:
+					_interval = atoi(optarg);
+					if(_interval < 1)
+					{
+						fprintf(stderr, "[ERR] --interval takes a number of refs > 0\n");
+						exit(-1);
+					}
+					break;
+				case OPT_SERIES_FILE:
+					snprintf(_series_file, sizeof(_series_file), "%s", optarg);
+					break;
+				case OPT_WARMUP:
+				case OPT_MEASURE:
+					if(atol(optarg) < 0 || (opt == OPT_MEASURE && atol(optarg) == 0))
+					{
+						fprintf(stderr, "[ERR] --%s takes a number of refs\n",
+								opt == OPT_WARMUP ? "warmup" : "measure");
+						exit(-1);
+					}
+					if(opt == OPT_WARMUP)
+						_warmup = atol(optarg);
+					else
+						_measure = atol(optarg);
+					break;
+				case OPT_CHECKPOINT:
+					snprintf(_checkpoint_file, sizeof(_checkpoint_file), "%s", optarg);
+					break;
+				case OPT_CHECKPOINT_EVERY:
+					_checkpoint_every = atol(optarg);
+					if(_checkpoint_every < 1)
+					{
+						fprintf(stderr, "[ERR] --checkpoint_every takes a number of refs > 0\n");
+						exit(-1);
+					}
+					break;
+				case OPT_RESTORE:
+					snprintf(_restore_file, sizeof(_restore_file), "%s", optarg);
+					break;
+				case OPT_ADDR_TRACE:
+					snprintf(_addr_trace_file, sizeof(_addr_trace_file), "%s", optarg);
+					if(access(_addr_trace_file, R_OK)!=0)
+					{
+						fprintf(stderr, "[ERR] cannot read %s\n", _addr_trace_file);
+						exit(-1);
+					}
+					break;
+				case OPT_PAGE_SIZE:
+					snprintf(_page_sizes, sizeof(_page_sizes), "%s", optarg);
+					break;
+				case OPT_FIT_MODEL:
+					snprintf(_fit_model_file, sizeof(_fit_model_file), "%s", optarg);
+					break;
+				case OPT_MODEL:
+					snprintf(_model_file, sizeof(_model_file), "%s", optarg);
+					break;
+				case OPT_GEN_THREADS:
+					_gen_threads = atoi(optarg);
+					break;
+				case OPT_ANALYZE_THREADS:
+					_analyze_threads = atoi(optarg);
+					break;
+				case OPT_PREFETCH:
+					_prefetch = prefetch_mode(optarg);
+					if(_prefetch < 0)
+					{
+						fprintf(stderr, "[ERR] --prefetch takes next, stride or adaptive\n");
+						exit(-1);
+					}
+					break;
+				case OPT_PREFETCH_N:
+					_prefetch_n = atoi(optarg);
+					if(_prefetch_n < 1)
+					{
+						fprintf(stderr, "[ERR] --prefetch_n takes a number of pages > 0\n");
+						exit(-1);
+					}
+					break;
+				case OPT_REPEAT:
+					_repeat = atoi(optarg);
+					if(_repeat < 1)
+					{
+						fprintf(stderr, "[ERR] --repeat takes a number of runs > 0\n");
+						exit(-1);
+					}
+					break;
+				case OPT_JOBS:
+					_jobs = atoi(optarg);
+					break;
+				case OPT_SWEEP:
+					snprintf(_sweep_spec, sizeof(_sweep_spec), "%s", optarg);
+					break;
+				case OPT_SHARD:
+					if(sweep_parse_shard(optarg, &_shard_index, &_shard_count) != 0)
+					{
+						fprintf(stderr, "[ERR] --shard takes i/N with 0 <= i < N\n");
+						exit(-1);
+					}
+					break;
+				case OPT_SWEEP_FILE:
+					snprintf(_sweep_file, sizeof(_sweep_file), "%s", optarg);
+					break;
+				case 0: // flag set by getopt_long
+					break;
 				default:
 					print_help(argv[0]);
 					break;
@@ -238,101 +505,424 @@ int main ( int argc, char *argv[] )
 			fprintf(stderr, "[ERR] one distribution a time please!! \n");
 			exit(-1);
 		}
+		if(_zipf_s > 0 && _num_of_hotpages > 0)
+		{
+			fprintf(stderr, "[ERR] --zipf and -h are different distributions, pick one\n");
+			exit(-1);
+		}
 		
 		if(strlen(algo_str)==0)
-			for(i=0; i< sizeof(algos)/sizeof(Algorithm); i++)
+			for(i=0; i< num_algos; i++)
 				algos[i].selected = 1;
 
+		if(_merge)
+			return merge_sweep_files(argc - optind, argv + optind);
+		if(_shard_count > 1 && strlen(_sweep_spec) == 0)
+		{
+			fprintf(stderr, "[ERR] --shard splits a --sweep\n");
+			exit(-1);
+		}
+		if(strlen(_sweep_spec) > 0 && _repeat > 1)
+		{
+			fprintf(stderr, "[ERR] --sweep runs each point once, drop --repeat\n");
+			exit(-1);
+		}
+		if(strlen(_sweep_spec) > 0)
+		{
+			sweep_runs();
+			return 0;
+		}
+		if(_repeat > 1)
+		{
+			repeat_runs();
+			return 0;
+		}
         init();
+		if(_analyze)
+		{
+			do
+				analyze_trace();
+			while(next_page_size());
+			cleanup();
+			return 0;
+		}
 		event_loop();
+		while(next_page_size())
+			event_loop();
         cleanup();
         return 0;
 }
 
 void print_page_ref_stat()
 {
-	Page_Ref* p=NULL;
 	int *page_ref_num=NULL;
-	int refs=0;
-	page_ref_num = malloc(sizeof(int) * page_ref_upper_bound);
-	LIST_FOREACH(p, &page_refs, pages )
-	{
-		page_ref_num[p->page_num]++;
-		refs++;
-		if(refs==max_page_calls)
-			break;
-	}
+	size_t refs=0;
+	page_ref_num = calloc(page_ref_upper_bound, sizeof(int));
+	for(refs=0; refs<max_page_calls && refs<page_ref_trace_len; refs++)
+		page_ref_num[page_ref_trace[refs]]++;
 
 	int i=0;
 	for(i=0; i<page_ref_upper_bound; i++)
-		printf("page[%02d] refs: %6d, percentage:%f\n", i, page_ref_num[i], (double)page_ref_num[i]/(double)refs);
+	{
+		if(trace_renumbered)
+			printf("page[%02d] (0x%llx) refs: %6d, percentage:%f\n", i, (unsigned long long)trace_ids.pages[i],
+					page_ref_num[i], (double)page_ref_num[i]/(double)refs);
+		else
+			printf("page[%02d] refs: %6d, percentage:%f\n", i, page_ref_num[i], (double)page_ref_num[i]/(double)refs);
+	}
 
-	printf("total number of references: %d\n", refs);
+	printf("total number of references: %zu\n", refs);
 	free(page_ref_num);
 }
 
+/**
+ * void analyze_trace()
+ *
+ * --analyze: footprint, reuse distances, gaps and hotness of the trace in
+ * one pass, instead of simulating it
+ */
+void analyze_trace()
+{
+	uint64_t start = now_ns();
+	int threads = _analyze_threads > 0 ? _analyze_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(trace_stats(stdout, page_ref_trace, max_page_calls, page_ref_upper_bound, threads) != 0)
+	{
+		fprintf(stderr, "[ERR] out of memory analyzing %ld refs of %d pages\n", max_page_calls, page_ref_upper_bound);
+		exit(-1);
+	}
+	if(_print_timing)
+		printf("Analysis: %.3f ms, %.1f ns/ref\n", (now_ns() - start) / 1e6,
+				max_page_calls > 0 ? (double)(now_ns() - start) / max_page_calls : 0.0);
+}
+
+/*
+ * append a page ref to the trace
+ */
+static void append_ref(int page_num)
+{
+	if(page_ref_trace_len == page_ref_trace_cap)
+	{
+		page_ref_trace_cap = page_ref_trace_cap ? page_ref_trace_cap * 2 : 4096;
+		page_ref_trace = realloc(page_ref_trace, page_ref_trace_cap * sizeof(int));
+		if(page_ref_trace == NULL)
+		{
+			perror("append_ref()");
+			exit(-1);
+		}
+	}
+	page_ref_trace[page_ref_trace_len++] = page_num;
+}
+
+/*
+ * OPTIMAL looks ahead until it has seen every page, so pad the trace
+ * with generated refs until the padding alone covers all pages
+ */
+static void pad_page_refs(int* hotpages, int nHotpages)
+{
+	int i=0;
+	int missing=page_ref_upper_bound; // pages not generated yet
+	int page_num=0;
+	optimum_find_test = (int*)malloc(page_ref_upper_bound*sizeof(int));
+	for(i = 0; i < page_ref_upper_bound; ++i)
+		optimum_find_test[i] = -1;
+
+	while(missing > 0)
+	{ // generate new refs until one of each have been added to list
+		page_num = gen_ref(hotpages, nHotpages);
+		append_ref(page_num);
+		if(optimum_find_test[page_num] == -1)
+			missing--;
+		optimum_find_test[page_num] = 1;
+		_num_refs++;
+	}
+}
+
+/*
+ * read a binary trace, see TRACE_MAGIC. fp is positioned after the magic.
+ */
+static long read_binary_refs(FILE *fp)
+{
+	uint64_t count=0;
+	size_t i=0;
+	if(fread(&count, sizeof(count), 1, fp) != 1 || count > LONG_MAX)
+	{
+		fprintf(stderr, "[ERR] %s: bad binary trace header\n", _trace_file);
+		exit(-1);
+	}
+	page_ref_trace_len = 0;
+	page_ref_trace_cap = count > 0 ? count : 1;
+	page_ref_trace = realloc(page_ref_trace, page_ref_trace_cap * sizeof(int));
+	if(page_ref_trace == NULL)
+	{
+		perror("read_binary_refs()");
+		exit(-1);
+	}
+	if(fread(page_ref_trace, sizeof(int32_t), count, fp) != count)
+	{
+		fprintf(stderr, "[ERR] %s: binary trace is truncated\n", _trace_file);
+		exit(-1);
+	}
+	page_ref_trace_len = count;
+	for(i = 0; i < page_ref_trace_len; i++)
+		page_ref_trace[i] = page_ids_intern(&trace_ids, (uint32_t)page_ref_trace[i]);
+	return (long)count;
+}
+
+/*
+ * read a text trace, one page number per line, decimal or 0x hex up to
+ * 64 bits. Lines without a number are skipped.
+ */
+static long read_text_refs(FILE *fp)
+{
+	char strPage[32]={};
+	char *end = NULL;
+	const char *p = NULL;
+	uint64_t page=0;
+	long refs=0;
+	page_ref_trace_len = 0;
+	while(fgets(strPage, sizeof(strPage), fp)!=NULL)
+	{
+		p = strPage + strspn(strPage, " \t");
+		page = strtoull(p, &end, p[0] == '0' && (p[1] == 'x' || p[1] == 'X') ? 16 : 10);
+		if(end != p)
+		{
+			append_ref(page_ids_intern(&trace_ids, page));
+			refs++;
+		}
+	}
+	return refs;
+}
+
+/*
+ * The loaders hand out dense ids in order of first reference. Pages that
+ * already fit below the page bound (-p, or 2 * frames) get their own
+ * numbers back, so small traces replay as before. Otherwise the dense
+ * ids stay and the bound becomes the number of distinct pages, which
+ * sizes every array indexed by page to the trace's footprint.
+ */
+static void settle_page_ids(void)
+{
+	int bound = page_ref_upper_bound > 0 ? page_ref_upper_bound : num_frames<<1;
+	uint64_t max_page = 0;
+	size_t i = 0;
+	int id = 0;
+	for(id = 0; id < trace_ids.count; id++)
+		if(trace_ids.pages[id] > max_page)
+			max_page = trace_ids.pages[id];
+	if(trace_ids.count == 0 || max_page < (uint64_t)bound)
+	{
+		for(i = 0; i < page_ref_trace_len; i++)
+			page_ref_trace[i] = (int)trace_ids.pages[page_ref_trace[i]];
+		page_ref_upper_bound = bound;
+		return;
+	}
+	trace_renumbered = 1;
+	page_ref_upper_bound = trace_ids.count;
+	fprintf(stderr, ">>> %d distinct pages up to 0x%llx, renumbered 0..%d\n", trace_ids.count,
+			(unsigned long long)max_page, trace_ids.count - 1);
+}
+
+/**
+ * int read_page_refs()
+ *
+ * Load the trace given with -t, text or binary (TRACE_MAGIC header)
+ *
+ * @return 0
+ */
 int read_page_refs()
 {
 
 	FILE *fp = NULL;
-	char strPage[8]={};
-	int refs=1;
-	if( (fp = fopen(_trace_file, "r") ) == NULL)
+	char magic[sizeof(TRACE_MAGIC) - 1]={};
+	long refs=0;
+	uint64_t t0 = now_ns();
+	if( (fp = fopen(_trace_file, "rb") ) == NULL)
 	{
 		perror("fopen()");
 		exit(-1);
 	}
-	
-	LIST_INIT(&page_refs);
-	Page_Ref *page = NULL;
-	Page_Ref *headp = NULL;
-	headp = malloc(sizeof(Page_Ref));
-	if(fgets(strPage, 1024, fp)!=NULL)
+	if(page_ids_init(&trace_ids, 1024) != 0)
 	{
-		headp->page_num = (int) atoi(strPage);
-		LIST_INSERT_HEAD(&page_refs, headp, pages);
-		while(fgets(strPage, 1024, fp)!=NULL)
-		{
-			if(strlen(strPage)>0)
-			{
-				page = malloc(sizeof(Page_Ref));
-				page->page_num = (int) atoi(strPage);
-	    	    LIST_INSERT_AFTER(headp, page,  pages);
-				headp = headp->pages.le_next;
-				refs++;
-			}
-		}
+		perror("read_page_refs()");
+		exit(-1);
 	}
 
+	if(fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+			memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0)
+	{
+		refs = read_binary_refs(fp);
+		trace_source = "loaded (binary)";
+	}
+	else
+	{
+		rewind(fp);
+		refs = read_text_refs(fp);
+		trace_source = "loaded (text)";
+	}
+	fclose(fp);
+	settle_page_ids();
+	trace_ns = now_ns() - t0;
 
-	
 	max_page_calls = refs;
 
 	/* init optimum_find_test for optimal algo */
-    optimum_find_test = (int*)malloc(page_ref_upper_bound*sizeof(int));
-        for(int i = 0; i < page_ref_upper_bound; ++i)
-                optimum_find_test[i] = -1;
-
-		int all_found=0;
-        while(all_found == 0)
-        { // generate new refs until one of each have been added to list
-                LIST_INSERT_AFTER(page, gen_ref(NULL, 0), pages);
-                page = page->pages.le_next;
-                optimum_find_test[page->page_num] = 1;
-                all_found = 1;
-                for(int i = 0; i < page_ref_upper_bound; ++i)
-                { // see if we've got them all yet
-                        if(optimum_find_test[i] == -1)
-                        {
-                                all_found = 0;
-                                break;
-                        }
-                }
-        }
+	pad_page_refs(NULL, 0);
+
+	return 0;
+}
+
+/*
+ * make addr_traces[k] the trace to simulate: its refs and ids replace the
+ * previous page size's, and the frames shrink as the pages grow so every
+ * page size gets the memory -f frames have at the first one
+ */
+static void load_page_size(int k)
+{
+	Addr_Trace *at = &addr_traces[k];
+	uint64_t frames = (uint64_t)base_frames * addr_traces[0].page_size / at->page_size;
+	char size_str[16];
+	free(page_ref_trace);
+	page_ids_free(&trace_ids);
+	free(optimum_find_test);
+	page_ref_trace = at->refs;
+	page_ref_trace_len = at->len;
+	page_ref_trace_cap = at->cap;
+	trace_ids = at->ids;
+	at->refs = NULL;
+	memset(&at->ids, 0, sizeof(at->ids));
+	page_size_run = k;
+
+	num_frames = frames < 1 ? 1 : frames > INT_MAX ? INT_MAX : (int)frames;
+	page_ref_upper_bound = base_page_bound;
+	trace_renumbered = 0;
+	settle_page_ids();
+	max_page_calls = page_ref_trace_len;
+	pad_page_refs(NULL, 0);
+	printf("Page size: %s, %d frames, %ld refs from %ld accesses, %d distinct pages\n",
+			page_size_str(at->page_size, size_str, sizeof(size_str)), num_frames,
+			max_page_calls, addr_accesses, trace_ids.count);
+}
+
+/**
+ * int read_addr_refs()
+ *
+ * Load the --addr_trace byte addresses as page refs at every --page_size
+ * in one read, then set up the first page size
+ *
+ * @return 0
+ */
+int read_addr_refs()
+{
+	uint64_t sizes[MAX_PAGE_SIZES];
+	uint64_t t0 = now_ns();
+	int i = 0;
+	num_page_sizes = parse_page_sizes(_page_sizes, sizes);
+	if(num_page_sizes < 1)
+	{
+		fprintf(stderr, "[ERR] --page_size takes powers of 2 like \"4K,64K,2M\", up to %d of them\n",
+				MAX_PAGE_SIZES);
+		exit(-1);
+	}
+	if(num_page_sizes > 1 && (strlen(_checkpoint_file) > 0 || strlen(_restore_file) > 0))
+	{
+		fprintf(stderr, "[ERR] --checkpoint and --restore take a single --page_size\n");
+		exit(-1);
+	}
+	for(i = 0; i < num_page_sizes; i++)
+	{
+		if(addr_trace_init(&addr_traces[i], sizes[i]) != 0)
+		{
+			perror("read_addr_refs()");
+			exit(-1);
+		}
+	}
+	addr_accesses = addr_trace_read(_addr_trace_file, addr_traces, num_page_sizes);
+	if(addr_accesses < 0)
+	{
+		perror("read_addr_refs()");
+		exit(-1);
+	}
+	trace_ns = now_ns() - t0;
+	trace_source = "loaded (addresses)";
+	load_page_size(0);
+	return 0;
+}
 
+/**
+ * int save_page_refs(const char *path)
+ *
+ * Write the refs to replay (not OPTIMAL's padding) so the trace can be
+ * replayed with -t. A path ending in ".bin" gets the binary format, which
+ * loads with one read, anything else one page number per line.
+ *
+ * @return 0, -1 if the file can't be written
+ */
+int save_page_refs(const char *path)
+{
+	FILE *fp = NULL;
+	size_t len = strlen(path);
+	uint64_t count = (uint64_t)max_page_calls;
+	int ok = 1;
+	size_t i = 0;
+	if(count > page_ref_trace_len)
+		count = page_ref_trace_len;
+	if((fp = fopen(path, "wb")) == NULL)
+	{
+		perror("save_page_refs()");
+		return -1;
+	}
+	if(len > 4 && strcmp(path + len - 4, ".bin") == 0)
+	{
+		ok = fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC) - 1, fp) == sizeof(TRACE_MAGIC) - 1 &&
+			fwrite(&count, sizeof(count), 1, fp) == 1 &&
+			fwrite(page_ref_trace, sizeof(int32_t), count, fp) == count;
+	}
+	else
+	{
+		for(i = 0; i < count && ok; i++)
+			ok = fprintf(fp, "%d\n", page_ref_trace[i]) > 0;
+	}
+	if(fclose(fp) != 0 || !ok)
+	{
+		perror("save_page_refs()");
+		return -1;
+	}
 	return 0;
 }
 
+/**
+ * int fit_page_model(const char *path)
+ *
+ * Write a --model of the trace to path, see trace_model.h
+ *
+ * @return 0, -1 on error
+ */
+int fit_page_model(const char *path)
+{
+	Trace_Model model;
+	if(trace_model_fit(&model, page_ref_trace, max_page_calls, page_ref_upper_bound) != 0)
+	{
+		fprintf(stderr, "[ERR] out of memory fitting a model of %ld refs\n", max_page_calls);
+		return -1;
+	}
+	return trace_model_save(&model, path);
+}
+
+/*
+ * the frames' ticks count refs, LRU and FIFO compare them and would pick
+ * the wrong victims after a wrap
+ */
+static void check_ticks(void)
+{
+#ifndef PAGESIM_SCALE
+	if(max_page_calls >= (long)TICK_MAX)
+	{
+		fprintf(stderr, "[ERR] %ld refs overflow the 32-bit ticks, build with \"make SCALE=1\"\n", max_page_calls);
+		exit(-1);
+	}
+#endif
+}
+
 /**
  * int init()
  *
@@ -344,10 +934,28 @@ int init()
 {
 
 	time(&_start_time);
-	max_page_calls = num_frames * pow((double)2, (double)_num_x);
-	//page_ref_upper_bound = num_frames<<1;
-	if(page_ref_upper_bound < 0)
+	base_frames = num_frames;
+	base_page_bound = page_ref_upper_bound;
+	if((strlen(_trace_file) > 0) + (strlen(_addr_trace_file) > 0) + (strlen(_model_file) > 0) > 1)
+	{
+		fprintf(stderr, "[ERR] -t, --addr_trace and --model all give the trace, pick one\n");
+		exit(-1);
+	}
+	if(_prefetch != PREFETCH_OFF && (strlen(_checkpoint_file) > 0 || strlen(_restore_file) > 0))
+	{ // the snapshot doesn't carry the prefetcher's streams or the baselines
+		fprintf(stderr, "[ERR] --prefetch doesn't work with --checkpoint or --restore\n");
+		exit(-1);
+	}
+	if(_num_x < 0 || _num_x > 62 || (long)num_frames > (LONG_MAX >> _num_x))
 	{
+		fprintf(stderr, "[ERR] %d frames * 2^%d refs doesn't fit in 64 bits\n", num_frames, _num_x);
+		exit(-1);
+	}
+	max_page_calls = (long)num_frames << _num_x;
+	//page_ref_upper_bound = num_frames<<1;
+	if(page_ref_upper_bound < 0 && strlen(_trace_file) == 0 && strlen(_addr_trace_file) == 0 &&
+			strlen(_model_file) == 0)
+	{ // a loaded trace or a model sets it, see settle_page_ids()
 		fprintf(stderr, ">>> # of distinct pages not set, set to %d\n", num_frames<<1);
 		page_ref_upper_bound=num_frames<<1;
 	}
@@ -362,47 +970,102 @@ int init()
 
 	struct timespec ts;
 	clock_gettime(CLOCK_REALTIME, &ts);
-	srand((int)ts.tv_nsec);
+	srand(_seed_set ? _seed : (unsigned int)ts.tv_nsec);
 
 
-	if(strlen(_trace_file)>0)
+	if(strlen(_addr_trace_file)>0)
+		read_addr_refs();
+	else if(strlen(_trace_file)>0)
 		read_page_refs();
+	else if(strlen(_model_file)>0)
+	{
+		check_ticks();
+		gen_model_refs();
+	}
 	else
+	{
+		check_ticks(); // before generating a trace this long
 		gen_page_refs();
+	}
 
-
-	if(_print_page_ref_stat)
-		print_page_ref_stat();
-    // Calculate number of algos
-    num_algos = sizeof(algos)/sizeof(Algorithm);
-    size_t i = 0;
-    for (i = 0; i < num_algos; ++i)
-            algos[i].data = create_algo_data_store();
+	check_ticks();
+	if(_warmup >= max_page_calls)
+	{
+		fprintf(stderr, "[ERR] --warmup %ld leaves nothing of the %ld refs to measure\n", _warmup, max_page_calls);
+		exit(-1);
+	}
+	if(_perf_counters)
+	{ // counters come on top of the timings, or replace them if there are none
+		_print_timing = 1;
+		if(perf_counters_open(&perf) == 0)
+			fprintf(stderr, ">>> performance counters unavailable, timing only\n");
+	}
+	if(_print_timing)
+		printf("Trace: %ld refs %s in %.3f ms, %.1f ns/ref\n", max_page_calls, trace_source,
+				trace_ns / 1e6, max_page_calls > 0 ? (double)trace_ns / max_page_calls : 0.0);
+	if(strlen(_save_trace_file)>0 && save_page_refs(_save_trace_file) != 0)
+		exit(-1);
+	if(strlen(_fit_model_file)>0 && fit_page_model(_fit_model_file) != 0)
+		exit(-1);
+
+
+	if(_print_page_ref_stat)
+		print_page_ref_stat();
+    create_algos();
+    if(strlen(_restore_file) > 0)
+    {
+            resume_at = checkpoint_restore(_restore_file);
+            printf("Restored %s at ref %zu\n", _restore_file, resume_at);
+    }
+    if(_checkpoint_every > 0 && strlen(_checkpoint_file) == 0)
+    {
+            fprintf(stderr, "[ERR] --checkpoint_every needs a --checkpoint file\n");
+            exit(-1);
+    }
+    if(_interval > 0 && !_analyze)
+            open_series();
     return 0;
 }
 
 /*
- * return 0 if time1 = time2
- * return -1 if time1 < time2
- * return 1 if time1 > time2
+ * table the Zipf CDF: page i is referenced with probability
+ * proportional to 1 / (i + 1)^_zipf_s, so page 0 is the hottest
  */
-int compare_time(struct timespec time1, struct timespec time2)
+static void init_zipf(void)
 {
-	int ret=0;
-	if(time1.tv_sec > time2.tv_sec)
-		ret = 1;
-	else if(time1.tv_sec < time2.tv_sec)
-		ret = -1;
-	else if(time1.tv_sec == time2.tv_sec)
+	int i=0;
+	double sum=0;
+	zipf_cdf = malloc(sizeof(double) * page_ref_upper_bound);
+	if(zipf_cdf == NULL)
+	{
+		perror("init_zipf()");
+		exit(-1);
+	}
+	for(i=0; i<page_ref_upper_bound; i++)
 	{
-		if(time1.tv_nsec > time2.tv_nsec)
-			ret = 1;
-		else if(time1.tv_nsec < time2.tv_nsec)
-			ret = -1;
-		else 
-			ret = 0;
+		sum += pow((double)(i + 1), -_zipf_s);
+		zipf_cdf[i] = sum;
+	}
+	for(i=0; i<page_ref_upper_bound; i++)
+		zipf_cdf[i] /= sum;
+}
+
+/*
+ * a Zipf distributed page number, by binary search of the CDF
+ */
+static int gen_zipf_ref(void)
+{
+	double u = (double)rand() / ((double)RAND_MAX + 1.0);
+	int lo = 0, hi = page_ref_upper_bound - 1, mid = 0;
+	while(lo < hi)
+	{ // first page whose CDF is above u
+		mid = lo + (hi - lo) / 2;
+		if(zipf_cdf[mid] > u)
+			hi = mid;
+		else
+			lo = mid + 1;
 	}
-	return ret;
+	return lo;
 }
 
 /**
@@ -415,107 +1078,141 @@ int compare_time(struct timespec time1, struct timespec time2)
 void gen_page_refs()
 {
 	int hotpages[_num_of_hotpages];
-	int i=0, j=0;
+	int i=0;
 	int dupe=0;
+	int scan_left=0, scan_next=0;
+	double scan_start=0; // chance that a ref starts a scan
+	uint64_t t0 = now_ns();
+
+	if(_scan_len > 0 && _scan_pct > 0)
+	{ // scans of _scan_len refs make up _scan_pct% of the trace
+		double f = _scan_pct / 100.0;
+		scan_start = f / (_scan_len * (1 - f) + f);
+	}
+
 
+	if(_zipf_s > 0)
+		init_zipf();
 
 	/* select non-duplicated  hot pages */
+	hot_map = bitmap_alloc(page_ref_upper_bound);
 	fprintf(stderr, "hot pages: ");
 	for(i=0; i<_num_of_hotpages; i++)
 	{
 		while(1)
 		{
 			hotpages[i]=rand() % page_ref_upper_bound;
-			dupe=0;
-
-			for(j=0; j<i; j++)
-			{
-				if(hotpages[j]==hotpages[i])
-				{
-					dupe=1;
-					break;
-				}
-			}
+			dupe=bitmap_test(hot_map, hotpages[i]);
 			if(dupe)
 				continue;
 			else
 				break;
 		}
+		bitmap_set(hot_map, hotpages[i]);
 
 		fprintf(stderr, "%d ", hotpages[i]);
 	}
 	fprintf(stderr, "\n");
 
         _num_refs = 0;
-        LIST_INIT(&page_refs);
-        Page_Ref *page = gen_ref(hotpages, _num_of_hotpages);
-        LIST_INSERT_HEAD(&page_refs, page, pages);
+        page_ref_trace_len = 0;
+        append_ref(gen_ref(hotpages, _num_of_hotpages));
         while(_num_refs < max_page_calls)
         { // generate a page ref up to max_page_calls and add to list
 
+			if(scan_left == 0 && scan_start > 0 &&
+					((double)rand()/(double)(RAND_MAX)) < scan_start)
+			{ // start a sequential scan at a random page
+				scan_left = _scan_len;
+				scan_next = rand() % page_ref_upper_bound;
+			}
 
-			if(_head_hot && _num_refs > max_page_calls/2)
+			if(scan_left > 0)
+			{
+				append_ref(scan_next);
+				scan_next = (scan_next + 1) % page_ref_upper_bound;
+				scan_left--;
+			}
+			else if(_head_hot && _num_refs > max_page_calls/2)
 			{
-                LIST_INSERT_AFTER(page, gen_ref(NULL, 0), pages);
+                append_ref(gen_ref(NULL, 0));
 			}
 			else if(_tail_hot && _num_refs < max_page_calls / 2 )
 			{
-                LIST_INSERT_AFTER(page, gen_ref(NULL, 0), pages);
+                append_ref(gen_ref(NULL, 0));
 			}
 			else if(_mid_hot && (_num_refs < max_page_calls/4 || _num_refs > max_page_calls*3/4))
 			{
-                LIST_INSERT_AFTER(page, gen_ref(NULL, 0), pages);
+                append_ref(gen_ref(NULL, 0));
 			}
 			else if(_dual_head_hot &&  _num_refs > max_page_calls/4 && _num_refs < max_page_calls*3/4)
 			{
-                LIST_INSERT_AFTER(page, gen_ref(NULL, 0), pages);
+                append_ref(gen_ref(NULL, 0));
+			}
+			else if(zipf_cdf != NULL)
+			{
+                append_ref(gen_zipf_ref());
 			}
 			else
 			{
-                LIST_INSERT_AFTER(page, gen_ref(hotpages, _num_of_hotpages), pages);
+                append_ref(gen_ref(hotpages, _num_of_hotpages));
 			}
 
-                page = page->pages.le_next;
                 _num_refs++;
         }
+        trace_ns = now_ns() - t0;
 
         // we need look-ahead for Optimal algorithm
-        int all_found = 0;
-        optimum_find_test = (int*)malloc(page_ref_upper_bound*sizeof(int));
-
-        for(i = 0; i < page_ref_upper_bound; ++i)
-                optimum_find_test[i] = -1;
-
-        while(all_found == 0)
-        { // generate new refs until one of each have been added to list
-                LIST_INSERT_AFTER(page, gen_ref(hotpages, _num_of_hotpages), pages);
-                page = page->pages.le_next;
-                optimum_find_test[page->page_num] = 1;
-                all_found = 1;
-                for(i = 0; i < page_ref_upper_bound; ++i)
-                { // see if we've got them all yet
-                        if(optimum_find_test[i] == -1)
-                        {
-                                all_found = 0;
-                                break;
-                        }
-                }
-                _num_refs++;
-        }
+        pad_page_refs(hotpages, _num_of_hotpages);
         return;
 }
 
 /**
- * Page_Ref* gen_ref()
+ * int gen_model_refs()
+ *
+ * Generate the refs from the --model file on --gen_threads threads, see
+ * trace_model.h. The model sets the number of pages, and --seed seeds it.
+ *
+ * @return 0
+ */
+int gen_model_refs()
+{
+	Trace_Model model;
+	uint64_t t0 = now_ns(), seed = 0;
+	int threads = _gen_threads > 0 ? _gen_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(trace_model_load(&model, _model_file) != 0)
+		exit(-1);
+	if(base_page_bound >= 0 && base_page_bound != model.pages)
+		fprintf(stderr, ">>> %s has %d pages, -p ignored\n", _model_file, model.pages);
+	page_ref_upper_bound = model.pages;
+	seed = ((uint64_t)rand() << 31) ^ (uint64_t)rand();
+	page_ref_trace = malloc(sizeof(int) * (max_page_calls > 0 ? max_page_calls : 1));
+	if(page_ref_trace == NULL ||
+			trace_model_gen(&model, page_ref_trace, max_page_calls, seed, threads) != 0)
+	{
+		fprintf(stderr, "[ERR] out of memory generating %ld refs from %s\n", max_page_calls, _model_file);
+		exit(-1);
+	}
+	page_ref_trace_len = page_ref_trace_cap = max_page_calls;
+	_num_refs = max_page_calls;
+	trace_ns = now_ns() - t0;
+	trace_source = "modeled";
+
+	// we need look-ahead for Optimal algorithm
+	pad_page_refs(NULL, 0);
+	return 0;
+}
+
+/**
+ * int gen_ref()
  *
  * generate a random page ref within bounds
  *
- * @return {Page_Ref*}
+ * @return {int} page number
  */
-Page_Ref* gen_ref(int* hotpages, int nHotpages)
+int gen_ref(int* hotpages, int nHotpages)
 {
 	int page_num = -1;
-	int i=0;
 //	int found=0;
 //	page_num = rand() % page_ref_upper_bound;
 
@@ -527,24 +1224,16 @@ Page_Ref* gen_ref(int* hotpages, int nHotpages)
 	else
 	{
 		while(1)
-		{
+		{ // a cold page, hot_map marks the hotpages
 			page_num = rand() % page_ref_upper_bound;
-			for(i=0; i<nHotpages; i++)
-			{
-				if(page_num == hotpages[i])
-					break;
-			}
-			if(i==nHotpages)
+			if(nHotpages == 0 || !bitmap_test(hot_map, page_num))
 				break;
 		}
 	}
 
 //	fprintf(stderr, "dice = %f\n", (double)rand()/(double)RAND_MAX);
 
-    Page_Ref *page = malloc(sizeof(Page_Ref));
-    page->page_num =  page_num;
-	//fprintf(stderr, "%s:%d page_num==%d\n", __FILE__, __LINE__, page->page_num);
-    return page;
+    return page_num;
 }
 
 /**
@@ -562,1279 +1251,927 @@ Algorithm_Data *create_algo_data_store()
 		data->swap_in = 0;
 		data->swap_out = 0;
 		data->total_ref_count = 0;
-        data->last_victim = NULL;
-        /* Initialize Lists */
-        TAILQ_INIT(&(data->page_ref_log));
-        TAILQ_INIT(&(data->page_window_log));
-        LIST_INIT(&(data->page_table));
-        LIST_INIT(&(data->victim_list));
-        LIST_INIT(&(data->swap_list));
-        /* Insert at the page_table. */
-        Frame *framep = create_empty_frame(0);
-        LIST_INSERT_HEAD(&(data->page_table), framep, frames);
-        /* Build the rest of the list. */
-        size_t i = 0;
-        for (i = 1; i < num_frames; ++i)
+        data->evictions = 0;
+        data->faults = 0;
+        data->series_refs = data->series_faults = data->series_evictions = 0;
+        data->clock_hand = 0;
+        data->policy_state = NULL;
+        data->prefetch = NULL;
+        memset(&data->timing, 0, sizeof(data->timing));
+        /* Empty page table */
+        if(frame_table_init(&data->page_table, num_frames) != 0)
+        {
+                perror("frame_table_init()");
+                exit(-1);
+        }
+        /* room for resident pages plus CLOCK_PRO's non-resident test pages */
+        data->ref_bits = bitmap_alloc(2 * num_frames + 1);
+        if(data->ref_bits == NULL || page_map_init(&data->page_index, 2 * num_frames + 1) != 0)
         {
-                LIST_INSERT_AFTER(framep, create_empty_frame(i), frames);
-                framep = framep->frames.le_next;
+                perror("create_algo_data_store()");
+                exit(-1);
         }
         return data;
 }
 
-/**
- * Frame* create_empty_frame(int num_frames)
- *
- * Creates an empty Frame for page table list
- *
- * @return {Frame*} empty Frame entry for page table list
+/*
+ * peak resident set size of the process so far
  */
-Frame* create_empty_frame(int index)
+static long peak_rss_kb(void)
 {
-        Frame *framep = malloc(sizeof(Frame));
-        framep->index = index;
-        framep->page = -1;
-        clock_gettime(CLOCK_REALTIME, &framep->time);
-        framep->extra = 0;
-        return framep;
+        struct rusage ru;
+        if(getrusage(RUSAGE_SELF, &ru) != 0)
+                return 0;
+        return ru.ru_maxrss; // KB on Linux
 }
 
-/**
- * int event_loop()
- *
- * page all selected algorithms with input ref
- *
- * @param page_ref {int} page to ref
- *
- * @return 0
+static uint64_t now_ns(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/*
+ * add a timed run of refs refs with faults misses to the least squares
+ * sums of time = hit_cost * refs + (miss_cost - hit_cost) * faults
  */
-int event_loop()
+static void add_timed_run(Algo_Timing *timing, size_t refs, size_t faults, uint64_t ns)
 {
-		int page_num = 0;
-        counter = 0;
-        while(counter < max_page_calls)
-        {
-				page_num =  get_ref();
-                page(page_num);
-                ++counter;
-				export(counter, page_num);
-        }
-        size_t i = 0;
-        for (i = 0; i < num_algos; i++)
-        {
-                if(algos[i].selected==1) {
-                        print_summary(algos[i]);
-                }
-        }
-        return 0;
+        timing->ns += ns;
+        timing->s_rr += (double)refs * refs;
+        timing->s_rf += (double)refs * faults;
+        timing->s_ff += (double)faults * faults;
+        timing->s_rt += (double)refs * ns;
+        timing->s_ft += (double)faults * ns;
 }
 
-/**
- * int get_ref()
- *
- * get a random ref
- *
- * @return {int}
+/*
+ * add the counter deltas between before and after to totals
  */
-int get_ref()
+static void add_perf(uint64_t totals[PERF_NUM_COUNTERS], const uint64_t before[PERF_NUM_COUNTERS],
+                const uint64_t after[PERF_NUM_COUNTERS])
 {
-        if (page_refs.lh_first != NULL)
-        { // pop Page_Ref off page_refs
-                int page_num = page_refs.lh_first->page_num;
-                LIST_REMOVE(page_refs.lh_first, pages);
-                return page_num;
-        }
-        else
-        { // just in case
-                return rand() % page_ref_upper_bound;
+        int i = 0;
+        for(i = 0; i < PERF_NUM_COUNTERS; i++)
+                totals[i] += after[i] - before[i];
+}
+
+/*
+ * print counters per million refs, "n/a" for those not available
+ */
+static void print_perf(const char *label, const uint64_t totals[PERF_NUM_COUNTERS], size_t refs)
+{
+        int i = 0;
+        printf("%s per 1M refs: ", label);
+        for(i = 0; i < PERF_NUM_COUNTERS; i++)
+        {
+                if(perf_counter_available(&perf, i))
+                        printf("%s %.0f", perf_counter_names[i], refs ? totals[i] * 1e6 / refs : 0.0);
+                else
+                        printf("%s n/a", perf_counter_names[i]);
+                printf(i + 1 < PERF_NUM_COUNTERS ? ", " : "\n");
         }
 }
 
 /**
- * int page()
- *
- * page all selected algorithms with input ref
+ * int timing_split(const Algo_Timing *timing, double *hit_ns, double *miss_ns)
  *
- * @param page_ref {int} referenced page number
+ * Estimate the cost of a hit and of a miss from the timed runs by least
+ * squares. Needs runs with different miss counts, so it fails for a
+ * trace that always hits or always misses.
  *
- * @return 0
+ * @return 0 on success, -1 if the costs can't be told apart
  */
-int page(int page_ref)
+int timing_split(const Algo_Timing *timing, double *hit_ns, double *miss_ns)
 {
-        last_page_ref = page_ref;
-        size_t i = 0;
-        for (i = 0; i < num_algos; i++)
-        {
-                if(algos[i].selected==1) {
-                        algos[i].algo(algos[i].data);
-                        if(printrefs == 1)
-                                print_stats(algos[i]);
-                }
-        }
-
+        double det = timing->s_rr * timing->s_ff - timing->s_rf * timing->s_rf;
+        double slope = 0;
+        *hit_ns = *miss_ns = 0;
+        if(det <= 1e-9 * timing->s_rr * timing->s_ff)
+                return -1;
+        *hit_ns = (timing->s_rt * timing->s_ff - timing->s_ft * timing->s_rf) / det;
+        slope = (timing->s_rr * timing->s_ft - timing->s_rf * timing->s_rt) / det;
+        *miss_ns = *hit_ns + slope;
+        // noise on short runs can push an estimate below zero
+        if(*hit_ns < 0)
+                *hit_ns = 0;
+        if(*miss_ns < 0)
+                *miss_ns = 0;
         return 0;
 }
 
-int export(int counter, int page_num)
+/*
+ * replay n refs through algo's kernel, or with the --prefetch stage in
+ * front of its policy
+ */
+static size_t replay_refs(Algorithm *algo, const int *refs, size_t n, int count)
 {
-	if(_fp==NULL)
-		_fp = fopen(EXPORT_FILE, "w+");
-
-
-	fprintf(_fp, "%d,%d\n", counter, last_page_ref);
-
-
-	return 0;
+        Algorithm_Data *data = algo->data;
+        if(data->prefetch != NULL)
+                return prefetch_replay(data->prefetch, data, algo->policy->access, refs, n, count);
+        return algo->policy->replay(data, refs, n, count);
 }
 
-int swap_in(struct Frame_List *swap_list)
+/*
+ * replay refs [from, to) with the kernel, TIMING_CHUNK refs per call.
+ * Each call is timed and its faults noted, so the clock is read twice
+ * per chunk rather than per ref, and timing_split() can still separate
+ * the hit and miss paths.
+ */
+static void replay_timed(Algorithm *algo, size_t from, size_t to, int count)
 {
-	int hit = 0;
-	struct Frame *fr=NULL;
-	LIST_FOREACH(fr, swap_list, frames)
-	{
-		if(fr->page == last_page_ref)
-		{
-			hit = 1;
-			clock_gettime(CLOCK_REALTIME, &fr->time);
-			break;
-		}
-	}
-
-	return hit;
+        Algorithm_Data *data = algo->data;
+        uint64_t t0 = 0;
+        size_t i = from, n = 0, faults = 0;
+        while(i < to)
+        {
+                n = to - i < TIMING_CHUNK ? to - i : TIMING_CHUNK;
+                t0 = now_ns();
+                faults = replay_refs(algo, page_ref_trace + i, n, count);
+                add_timed_run(&data->timing, n, faults, now_ns() - t0);
+                data->faults += faults;
+                i += n;
+        }
 }
 
-int swap_out(struct Frame_List *swap_list, struct Frame *frame)
+/*
+ * refs [*lo, *hi) of the trace count towards algo's hits and misses.
+ * --warmup/--measure set one interval for every algorithm. Without them
+ * the -w window leaves out _window_size refs at both ends, unless the
+ * policy counts the full trace.
+ */
+static void counted_range(const Algorithm *algo, size_t *lo, size_t *hi)
 {
-        if(debug_flag)
-                printf("swap out index: %d, Page: %d\n", frame->index, frame->page);
-        struct Frame *swap = malloc(sizeof(Frame));
-        *swap = *frame;
-        swap->index = -1;
-        LIST_INSERT_HEAD(swap_list, swap, frames);
-        return 0;
+        *lo = 0;
+        *hi = max_page_calls;
+        if(_warmup >= 0 || _measure > 0)
+        {
+                *lo = _warmup > 0 ? (size_t)_warmup : 0;
+                if(_measure > 0 && *lo + _measure < *hi)
+                        *hi = *lo + _measure;
+        }
+        else if(_window_size > 0 && !(algo->policy->flags & POLICY_FULL_TRACE))
+        { // ref k is counted when k + 1 >= _window_size && k + 1 + _window_size < max_page_calls
+                *lo = _window_size - 1;
+                *hi = max_page_calls > _window_size + 1 ? max_page_calls - _window_size - 1 : 0;
+        }
+        if(*lo > (size_t)max_page_calls)
+                *lo = max_page_calls;
+        if(*hi < *lo)
+                *hi = *lo;
 }
 
-/**
- * int add_victim(struct Frame_List *victim_list, struct Frame *frame)
- *
- * Add victim frame evicted from page table to list of victims
- *
- * @param index {Frame_List} list of victims
- * @param page {Frame} page frame evicted
- *
- * @retun 0
+/*
+ * replay refs [from, to) without counting them: one kernel call, no
+ * chunking for the hit/miss timings. This is the warm-up fast path.
  */
-int add_victim(struct Frame_List *victim_list, struct Frame *frame)
+static void replay_uncounted(Algorithm *algo, size_t from, size_t to)
 {
-        if(debug_flag)
-                printf("Victim index: %d, Page: %d\n", frame->index, frame->page);
-        struct Frame *victim = malloc(sizeof(Frame));
-        *victim = *frame;
-        victim->index = -1;
-        LIST_INSERT_HEAD(victim_list, victim, frames);
-        return 0;
+        Algorithm_Data *data = algo->data;
+        uint64_t t0 = now_ns();
+        if(to <= from)
+                return;
+        data->faults += replay_refs(algo, page_ref_trace + from, to - from, 0);
+        data->timing.ns += now_ns() - t0;
 }
 
+/*
+ * replay refs [from, to) of the trace through one algorithm with its
+ * kernel. The counted range is resolved here into ranges replayed with
+ * and without counting, matching page_algo()'s per ref test.
+ */
+static void replay_algo(Algorithm *algo, size_t from, size_t to)
+{
+        size_t lo = 0, hi = 0; // refs [lo, hi) are counted
+        size_t a = 0, b = 0;
+        uint64_t before[PERF_NUM_COUNTERS], after[PERF_NUM_COUNTERS];
+        if(perf.n > 0)
+                perf_counters_read(&perf, before);
+        counted_range(algo, &lo, &hi);
+        a = from < lo ? (to < lo ? to : lo) : from;
+        b = a < hi ? (to < hi ? to : hi) : a;
+        replay_uncounted(algo, from, a);
+        replay_timed(algo, a, b, 1);
+        replay_uncounted(algo, b, to);
+        if(perf.n > 0)
+        {
+                perf_counters_read(&perf, after);
+                add_perf(algo->data->timing.perf, before, after);
+        }
+        if(algo->baseline != NULL)
+        { // the same refs without --prefetch, counted alike and left out of the timings
+                algo->baseline->faults += algo->policy->replay(algo->baseline, page_ref_trace + from, a - from, 0);
+                algo->baseline->faults += algo->policy->replay(algo->baseline, page_ref_trace + a, b - a, 1);
+                algo->baseline->faults += algo->policy->replay(algo->baseline, page_ref_trace + b, to - b, 0);
+        }
+}
 
-/**
- * int OPTIMAL(Algorithm_Data *data)
- *
- * OPTIMAL Page Replacement Algorithm
- *
- * @param *data {Algorithm_Data} struct holding algorithm data
- *
- * return {int} did page fault, 0 or 1
+/*
+ * fresh data for every algorithm, sized by num_frames. With --prefetch
+ * the selected ones get a prefetcher and a baseline replaying the trace
+ * without it. The baselines are set up last so the policies' own init
+ * sees the same rand() sequence as without --prefetch.
  */
-int OPTIMAL(Algorithm_Data *data)
+static void create_algos(void)
 {
-        Frame *framep = data->page_table.lh_first,
-              *victim = NULL;
-        int fault = 0;
-data->total_ref_count++;
-        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
-        while (framep != NULL && framep->page > -1 && framep->page != last_page_ref) {
-                framep = framep->frames.le_next;
+        size_t i = 0;
+        for (i = 0; i < num_algos; ++i)
+        {
+                algos[i].data = create_algo_data_store();
+                if(algos[i].policy->init != NULL)
+                        algos[i].policy->init(algos[i].data);
         }
-        if(framep == NULL)
-        { // It's a miss, find our victim
-                size_t i,j;
-                for(i = 0; i < page_ref_upper_bound; ++i)
-                        optimum_find_test[i] = -1;
-                Page_Ref *page = page_refs.lh_first;
-                int all_found = 0;
-                j = 0;
-                //optimum_find_test = malloc(sizeof(int)*page_ref_upper_bound);
-                while(all_found == 0)
+        if(_prefetch == PREFETCH_OFF)
+                return;
+        for (i = 0; i < num_algos; ++i)
+        {
+                if(algos[i].selected != 1)
+                        continue;
+                algos[i].data->prefetch = prefetch_create(_prefetch, _prefetch_n, page_ref_upper_bound,
+                                trace_renumbered ? &trace_ids : NULL);
+                if(algos[i].data->prefetch == NULL)
                 {
-                        if(optimum_find_test[page->page_num] == -1)
-						{
-//							fprintf(stderr, "optimum %d set to %zu\n", page->page_num, j);
-                                optimum_find_test[page->page_num] = j++;
-						}
-                        all_found = 1;
-//						fprintf(stderr, "%s:%d\n", __FILE__, __LINE__);
-                        for(i = 0; i < page_ref_upper_bound; ++i)
-						{
-                                if(optimum_find_test[i] == -1)
-                                {
-//									fprintf(stderr, "optimum %zu = -1\n", i);
-                                        all_found = 0;
-                                        break;
-                                }
-						}
-//						fprintf(stderr, "%s:%d\n", __FILE__, __LINE__);
-						page = page->pages.le_next;
-//						fprintf(stderr, "%s:%d page =%p\n", __FILE__, __LINE__, page);
-							
-                }
-//				fprintf(stderr, "%s:%d\n", __FILE__, __LINE__);
-                framep = data->page_table.lh_first;
-                while (framep != NULL) {
-                        if(victim == NULL || optimum_find_test[framep->page] > optimum_find_test[victim->page])
-                        { // No victim yet or page used further in future than victim
-                                victim = framep;
-                        }
-                        framep = framep->frames.le_next;
+                        perror("prefetch_create()");
+                        exit(-1);
                 }
-                if(debug_flag) printf("Victim selected: %d, Page: %d\n", victim->index, victim->page);
-                add_victim(&data->victim_list, victim);
-                victim->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&victim->time );
-                victim->extra = counter;
-                fault = 1;
+                algos[i].baseline = create_algo_data_store();
+                if(algos[i].policy->init != NULL)
+                        algos[i].policy->init(algos[i].baseline);
         }
-        else if(framep->page == -1)
-        { // Use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-                fault = 1;
-        }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-        }
-        if(debug_flag)
+}
+
+static void free_algo_data(const Algorithm *algo, Algorithm_Data *data)
+{
+        if(algo->policy->destroy != NULL)
+                algo->policy->destroy(data);
+        else
+                free(data->policy_state);
+        frame_table_free(&data->page_table);
+        page_map_free(&data->page_index);
+        free(data->ref_bits);
+        prefetch_free(data->prefetch);
+        free(data);
+}
+
+static void free_algos(void)
+{
+        size_t i = 0;
+        for (i = 0; i < num_algos; i++)
         {
-                printf("Page Ref: %d\n", last_page_ref);
-                for (framep = data->page_table.lh_first; framep != NULL; framep = framep->frames.le_next)
-                        printf("Slot: %d, Page: %d, Time used: %d\n", framep->index, framep->page, framep->extra);
+                free_algo_data(&algos[i], algos[i].data);
+                algos[i].data = NULL;
+                if(algos[i].baseline != NULL)
+                        free_algo_data(&algos[i], algos[i].baseline);
+                algos[i].baseline = NULL;
         }
-
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-				if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-				if(fault == 1) data->misses++; else data->hits++;
-        return fault;
 }
 
 /**
- * int RANDOM(Algorithm_Data *data)
+ * int next_page_size()
  *
- * RANDOM Page Replacement Algorithm
+ * After a run of an --addr_trace, set up the next --page_size with fresh
+ * algorithms
  *
- * @param *data {Algorithm_Data} struct holding algorithm data
- *
- * return {int} did page fault, 0 or 1
+ * @return 1 if there's another page size to run, 0 when done
  */
-int RANDOM(Algorithm_Data *data)
+int next_page_size()
 {
-        struct Frame *framep = data->page_table.lh_first,
-                     *victim = NULL;
-        int rand_victim = rand() % num_frames;
-        int fault = 0;
-		data->total_ref_count++;
-        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
-        while (framep != NULL && framep->page > -1 && framep->page != last_page_ref) {
-                if(framep->index == rand_victim) // rand
-                        victim = framep;
-                framep = framep->frames.le_next;
-        }
-        if(framep == NULL)
-        { // It's a miss, kill our victim
-                if(debug_flag) printf("Victim selected: %d, Page: %d\n", victim->index, victim->page);
-                add_victim(&data->victim_list, victim);
-                victim->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&victim->time );
-                victim->extra = counter;
-                fault = 1;
-        }
-        else if(framep->page == -1)
-        { // Use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-                fault = 1;
-        }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
+        if(page_size_run < 0 || page_size_run + 1 >= num_page_sizes)
+                return 0;
+        free_algos();
+        load_page_size(page_size_run + 1);
+        check_ticks();
+        create_algos();
+        return 1;
+}
+
+/*
+ * start the time series, once for every --page_size run: fully
+ * buffered, so a point costs one fprintf into memory per algorithm
+ */
+static void open_series(void)
+{
+        series_fp = strlen(_series_file) > 0 ? fopen(_series_file, "w") : stdout;
+        if(series_fp == NULL)
+        {
+                perror("open_series()");
+                exit(-1);
         }
-        if(debug_flag)
+        if(series_fp != stdout)
+                setvbuf(series_fp, NULL, _IOFBF, 1 << 20);
+        fprintf(series_fp, "ref,algorithm,refs,hits,misses,evictions,hit_ratio,miss_rate,page_size\n");
+}
+
+/*
+ * one time series point per algorithm: what happened since the last
+ * point, over every ref (the -w window doesn't apply, the series is
+ * what shows warm-up)
+ */
+static void series_point(size_t ref)
+{
+        size_t i = 0, refs = 0, faults = 0;
+        for (i = 0; i < num_algos; i++)
         {
-                printf("Page Ref: %d\n", last_page_ref);
-                for (framep = data->page_table.lh_first; framep != NULL; framep = framep->frames.le_next)
-                        printf("Slot: %d, Page: %d, Time used: %d\n", framep->index, framep->page, framep->extra);
+                Algorithm_Data *data = algos[i].data;
+                if(algos[i].selected != 1)
+                        continue;
+                refs = data->total_ref_count - data->series_refs;
+                faults = data->faults - data->series_faults;
+                fprintf(series_fp, "%zu,%s,%zu,%zu,%zu,%zu,%f,%f,%llu\n", ref, algos[i].policy->label,
+                                refs, refs - faults, faults, data->evictions - data->series_evictions,
+                                refs ? (double)(refs - faults) / refs : 0.0,
+                                refs ? (double)faults / refs : 0.0,
+                                page_size_run < 0 ? 0ULL : (unsigned long long)addr_traces[page_size_run].page_size);
+                data->series_refs = data->total_ref_count;
+                data->series_faults = data->faults;
+                data->series_evictions = data->evictions;
         }
+}
 
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-    	    if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-    	    if(fault == 1) data->misses++; else data->hits++;
+#define EXPORT_ROW_MAX 34 // the longest "%zu,%d\n" row
+static char *export_buf = NULL; // a block's rows, see export_row()
+static size_t export_len = 0;
+
+/*
+ * export() of the block path: the row goes into export_buf, formatted by
+ * hand, and export_flush() writes the block at once. A fprintf() per ref
+ * cost more than most policies' replay. The bytes are export()'s.
+ */
+static void export_row(size_t counter, int page_num)
+{
+	char row[EXPORT_ROW_MAX], *p = row + sizeof(row);
+	unsigned int v = page_num < 0 ? 0u - (unsigned int)page_num : (unsigned int)page_num;
+	if(!_export)
+		return;
+	if(export_buf == NULL && (export_buf = malloc(REPLAY_BLOCK * EXPORT_ROW_MAX)) == NULL)
+	{
+		perror("export_row()");
+		exit(-1);
+	}
+	*--p = '\n';
+	do
+		*--p = '0' + v % 10;
+	while((v /= 10) > 0);
+	if(page_num < 0)
+		*--p = '-';
+	*--p = ',';
+	do
+		*--p = '0' + counter % 10;
+	while((counter /= 10) > 0);
+	memcpy(export_buf + export_len, p, row + sizeof(row) - p);
+	export_len += row + sizeof(row) - p;
+}
 
-        return fault;
+static void export_flush(void)
+{
+	if(export_len == 0)
+		return;
+	if(_fp==NULL)
+		_fp = fopen(EXPORT_FILE, "w+");
+	fwrite(export_buf, 1, export_len, _fp);
+	export_len = 0;
 }
 
 /**
- * int FIFO(Algorithm_Data *data)
- *
- * FIFO Page Replacement Algorithm
+ * int event_loop()
  *
- * @param *data {Algorithm_Data} struct holding algorithm data
+ * page all selected algorithms with every ref of the trace. The trace is
+ * cut into blocks of REPLAY_BLOCK refs and each algorithm replays a block
+ * with its kernel before the next algorithm runs, so one algorithm's state
+ * stays in cache for the whole block. Algorithms don't share state, so the
+ * results match the interleaved order, which is still used when the page
+ * tables are printed or debugged after every ref. With --measure the run
+ * stops at the end of the measured refs. With --interval, blocks
+ * also end on interval boundaries, where the time series gets a point.
+ * With --checkpoint the state is saved every --checkpoint_every refs and
+ * at the end, and with --restore the run starts where a snapshot left off.
  *
- * return {int} did page fault, 0 or 1
+ * @return 0
  */
-int FIFO(Algorithm_Data *data)
+int event_loop()
 {
-        struct Frame *framep = data->page_table.lh_first,
-                     *victim = NULL;
-        int fault = 0;
-		data->total_ref_count++;
-        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
-        while (framep != NULL && 
-				framep->page > -1 && 
-				framep->page != last_page_ref) 
-		{
-                if(victim == NULL || 
-					compare_time(framep->time, victim->time)==1)
-                { // No victim yet or frame older than victim
-                        victim = framep;
+		int page_num = 0;
+        size_t i = 0;
+        size_t start = 0, end = 0;
+        size_t run_end = max_page_calls; // refs to replay, the run stops after --measure
+        uint64_t before[PERF_NUM_COUNTERS], after[PERF_NUM_COUNTERS];
+        counter = resume_at;
+        if(_measure > 0 && (_warmup > 0 ? _warmup : 0) + _measure < max_page_calls)
+                run_end = (_warmup > 0 ? _warmup : 0) + _measure;
+        if(perf.n > 0)
+                perf_counters_read(&perf, before);
+        if(printrefs || debug_flag)
+        {
+                while(counter < run_end)
+                {
+                        page_num =  get_ref();
+                        page(page_num);
+                        ++counter;
+                        export(counter, page_num);
+                        if(_interval > 0 && (counter % _interval == 0 || counter == run_end))
+                                series_point(counter);
+                        if(_checkpoint_every > 0 && counter % _checkpoint_every == 0 && counter < run_end)
+                                checkpoint_save(_checkpoint_file, counter);
                 }
-                framep = framep->frames.le_next;
         }
-        /* Make a decision */
-        if(framep == NULL)
-        { // It's a miss, kill our victim
-                if(debug_flag) printf("Victim selected: %d, Page: %d\n", victim->index, victim->page);
-                add_victim(&data->victim_list, victim);
-                victim->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&victim->time );
-                victim->extra = counter;
-                fault = 1;
+        else
+        {
+                for (start = resume_at; start < run_end; start = end)
+                {
+                        end = start + REPLAY_BLOCK < run_end ? start + REPLAY_BLOCK : run_end;
+                        if(_interval > 0 && (start / _interval + 1) * _interval < end)
+                                end = (start / _interval + 1) * _interval;
+                        if(_checkpoint_every > 0 && (start / _checkpoint_every + 1) * _checkpoint_every < end)
+                                end = (start / _checkpoint_every + 1) * _checkpoint_every;
+                        for (i = 0; i < num_algos; i++)
+                                if(algos[i].selected==1)
+                                        replay_algo(&algos[i], start, end);
+                        while(counter < end)
+                        {
+                                page_num =  get_ref();
+                                last_page_ref = page_num;
+                                ++counter;
+                                export_row(counter, page_num);
+                        }
+                        export_flush(); // a block is at most REPLAY_BLOCK rows
+                        if(_interval > 0 && (end % _interval == 0 || end == run_end))
+                                series_point(end);
+                        if(_checkpoint_every > 0 && end % _checkpoint_every == 0 && end < run_end)
+                                checkpoint_save(_checkpoint_file, end);
+                }
         }
-        else if(framep->page == -1)
-        { // Can use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-                fault = 1;
+        if(strlen(_checkpoint_file) > 0)
+                checkpoint_save(_checkpoint_file, counter);
+        if(perf.n > 0)
+        {
+                perf_counters_read(&perf, after);
+                add_perf(loop_perf, before, after);
         }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				//clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
+        for (i = 0; i < num_algos; i++)
+        {
+                if(algos[i].selected==1) {
+                        print_summary(algos[i]);
+                }
         }
-
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-			    if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-			if(fault == 1) data->misses++; else data->hits++;
-        return fault;
+        if(perf.n > 0)
+                print_perf("Event loop", loop_perf, max_page_calls);
+        if(_print_timing)
+                printf("Peak RSS: %ld KB\n", peak_rss_kb());
+        if(strlen(_stats_file) > 0)
+                write_stats_file(_stats_file);
+        return 0;
 }
 
-
-int LOG_NOWIN(Algorithm_Data *data)
+/*
+ * 97.5% quantile of Student's t with df degrees of freedom, the half
+ * width of a 95% confidence interval in standard errors
+ */
+static double t_975(int df)
 {
-        struct Frame *framep = data->page_table.lh_first, // lh_first = first element of queue 
-                     *victim = NULL;
-
-		struct Page_Log *page = NULL;
-        int fault = 0;
-		data->total_ref_count++;
-
-
-		/* increase page reference count by 1 */
-		int counted=0; 
-		struct Page_Log *pg = NULL;
-		TAILQ_FOREACH(pg, &data->page_ref_log, pages)
-		{
-			if(pg->page_num == last_page_ref)
-			{
-				pg->ref_count++;
-				counted = 1;
-				break;
-			}
-		}
+        static const double table[30] = {
+                12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+        if(df < 1)
+                return 0;
+        if(df <= 30)
+                return table[df - 1];
+        return 1.959964 + 2.3722 / df; // Cornish-Fisher, within 0.001 past 30
+}
 
-		if(counted ==0) // if this page is never referenced before, add to log
-		{
-			page = malloc(sizeof(struct Page_Log));
-			page->page_num = last_page_ref;
-			page->ref_count = 1;
-			TAILQ_INSERT_TAIL(&data->page_ref_log, page, pages);
-			//data->page_ref_log_size++;
-		}
 /*
-		page = malloc(sizeof(struct Page_Log));
-		page->page_num = last_page_ref;
-		// insert to window log here
-		TAILQ_INSERT_TAIL(&data->page_window_log, page, pages);
-		data->page_ref_log_size++;
-		if(_window_size > 0 && data->page_ref_log_size > _window_size)
-		{
-			page = data->page_window_log.tqh_first;
-			TAILQ_FOREACH(pg, &data->page_ref_log, pages)
-			{
-				if(pg->page_num == page->page_num)
-				{
-					pg->ref_count--;
-					break;
-				}
-			}
-			if(page != NULL) // just in case 
-			{
-				TAILQ_REMOVE(&data->page_window_log, data->page_window_log.tqh_first, pages);
-				data->page_ref_log_size--;
-			}
-		}
-*/
-
-		/*
-		 * search log list for ref_count of page num contained by frame list.
-		 * pick the one with lowest hotness to evict. 
-		 */
-		double hotness = 0.0;
-		double min_hotness=1.0;
-		while(framep != NULL &&
-				framep->page > -1 &&
-				framep->page != last_page_ref)
-		{
-
-			/*
-			if( _window_size > 0 && data->page_ref_log_size < _window_size)
-			{
-				if(victim==NULL || compare_time(framep->time, victim->time)==-1)
-					victim = framep;
-			}
-			else
-			{
-			*/
-				TAILQ_FOREACH(pg, &data->page_ref_log, pages)
-				{
-					if(framep->page == pg->page_num)
-					{
-						//fprintf(stderr, "%s:%d page %d hotness = %f\n", __FILE__, __LINE__, pg->page_num, (double)pg->ref_count/(double)data->total_ref_count);
-						hotness = (double)pg->ref_count/(double)data->total_ref_count;
-						if(hotness < min_hotness)
-						{
-							min_hotness = hotness;
-							victim = framep;
-						}
-					}
-				}
-			//}
-
-            framep = framep->frames.le_next;
-		}
-
-        /* Make a decision */
-        if(framep == NULL) 
-        { // It's a miss, kill our victim, need to swap
-
-
-			/*
-			 * search swap list, if hit in swap, swap-in, else swap-out
-			 * in this implementation, DAX is not supported. 
-			 * victim is pointing to memory page to be evicted. 
-			 * 1. add victim to victim list
-			 * 1.2. check swap_list and swap-in if found in swap_list
-			 * 1.3. if hit in swap, renew the reference time in swap.
-			 * 1.5. if miss in swap, swap-out victim page to swap_list
-			 * 2. change victim page's value to referenced page
-			 */
-
-
-			if(debug_flag) printf("Victim selected: %d, Page: %d\n", victim->index, victim->page);
-			add_victim(&data->victim_list, victim);
-
-
-			/*
-			if(swap_in(&data->swap_list)==1) // last_page_ref is found in swap_list
-				data->swap_in++;
-			else
-			{
-				swap_out(&data->swap_list, victim);
-				data->swap_out++;
-			}
-			*/
-
-			victim->page = last_page_ref;
-			clock_gettime(CLOCK_REALTIME,&victim->time );
-			victim->extra = counter;
-			fault = 1;
-
-
+ * check the options suit runs in workers: they would all write the same
+ * files, and their output goes nowhere
+ */
+static void check_worker_options(const char *mode)
+{
+        if(strlen(_checkpoint_file) > 0 || strlen(_restore_file) > 0 || strlen(_stats_file) > 0 ||
+                        strlen(_save_trace_file) > 0 || strlen(_fit_model_file) > 0 || _interval > 0 ||
+                        _analyze || printrefs || debug_flag || _print_page_ref_stat || strchr(_page_sizes, ',') != NULL ||
+                        _print_timing || _perf_counters || _prefetch != PREFETCH_OFF)
+        {
+                fprintf(stderr, "[ERR] %s only reports hit ratios, run single simulations for files, --analyze, "
+                                "--timing, --perf, --prefetch, -v, -d, --ref_stat or more than one --page_size\n", mode);
+                exit(-1);
         }
-        else if(framep->page == -1)
-        { // Can use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-                fault = 1;
+}
+
+/*
+ * a worker: one whole simulation set up by setup(run), output and the
+ * EXPORT_FILE discarded, then each policy's hits and misses down the
+ * pipe. Only the first worker keeps stderr, so an error shows once.
+ */
+static void run_worker(int run, void (*setup)(int run), int fd)
+{
+        size_t counts[MAX_POLICIES][2];
+        size_t i = 0, off = 0;
+        ssize_t n = 0;
+        if(freopen("/dev/null", "w", stdout) == NULL || (run > 0 && freopen("/dev/null", "w", stderr) == NULL))
+                _exit(-1);
+        _export = 0; // the workers would all append to the same file
+        setup(run);
+        init();
+        event_loop();
+        memset(counts, 0, sizeof(counts));
+        for(i = 0; i < num_algos; i++)
+        {
+                if(algos[i].selected != 1)
+                        continue;
+                counts[i][0] = algos[i].data->hits;
+                counts[i][1] = algos[i].data->misses;
         }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
+        for(off = 0; off < sizeof(counts[0]) * num_algos; off += n)
+        {
+                n = write(fd, (char *)counts + off, sizeof(counts[0]) * num_algos - off);
+                if(n <= 0)
+                        _exit(-1);
         }
-
-		/*
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-				if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-		*/
-				if(fault == 1) data->misses++; else data->hits++;
-
-        return fault;
+        fflush(NULL);
+        _exit(0);
 }
 
-int LOG(Algorithm_Data *data)
+/*
+ * runs simulations, each a forked worker with its own copy of the trace
+ * and the policies (they live in globals), --jobs at a time. Each policy's
+ * hits and misses of run r come back in counts[r].
+ *
+ * @return -1, or the run that failed after stopping the others
+ */
+static int run_workers(int runs, void (*setup)(int run), size_t (*counts)[MAX_POLICIES][2])
 {
-        struct Frame *framep = data->page_table.lh_first, // lh_first = first element of queue 
-                     *victim = NULL;
-
-		struct Page_Log *page = NULL;
-        int fault = 0;
-		data->total_ref_count++;
-
-
-		/* increase page reference count by 1 */
-		int counted=0; 
-		struct Page_Log *pg = NULL;
-		TAILQ_FOREACH(pg, &data->page_ref_log, pages)
-		{
-			if(pg->page_num == last_page_ref)
-			{
-				pg->ref_count++;
-				counted = 1;
-				break;
-			}
-		}
-
-		if(counted ==0) // if this page is never referenced before, add to log
-		{
-			page = malloc(sizeof(struct Page_Log));
-			page->page_num = last_page_ref;
-			page->ref_count = 1;
-			TAILQ_INSERT_TAIL(&data->page_ref_log, page, pages);
-			//data->page_ref_log_size++;
-		}
-
-		page = malloc(sizeof(struct Page_Log));
-		page->page_num = last_page_ref;
-		// insert to window log here
-		TAILQ_INSERT_TAIL(&data->page_window_log, page, pages);
-		data->page_ref_log_size++;
-
-		if(_window_size > 0 && data->page_ref_log_size > _window_size)
-		{
-			page = data->page_window_log.tqh_first;
-			TAILQ_FOREACH(pg, &data->page_ref_log, pages)
-			{
-				if(pg->page_num == page->page_num)
-				{
-					pg->ref_count--;
-					break;
-				}
-			}
-			if(page != NULL) // just in case 
-			{
-				TAILQ_REMOVE(&data->page_window_log, data->page_window_log.tqh_first, pages);
-				data->page_ref_log_size--;
-			}
-		}
-
-		/*
-		 * search log list for ref_count of page num contained by frame list.
-		 * pick the one with lowest hotness to evict. 
-		 */
-		double hotness = 0.0;
-		double min_hotness=1.0;
-		while(framep != NULL &&
-				framep->page > -1 &&
-				framep->page != last_page_ref)
-		{
-
-			if( _window_size > 0 && data->page_ref_log_size < _window_size)
-			{
-				if(victim==NULL || compare_time(framep->time, victim->time)==-1)
-					victim = framep;
-			}
-			else
-			{
-				TAILQ_FOREACH(pg, &data->page_ref_log, pages)
-				{
-					if(framep->page == pg->page_num)
-					{
-						//fprintf(stderr, "%s:%d page %d hotness = %f\n", __FILE__, __LINE__, pg->page_num, (double)pg->ref_count/(double)data->total_ref_count);
-						hotness = (double)pg->ref_count/(double)data->total_ref_count;
-						if(hotness < min_hotness)
-						{
-							min_hotness = hotness;
-							victim = framep;
-						}
-					}
-				}
-			}
-
-            framep = framep->frames.le_next;
-		}
-
-        /* Make a decision */
-        if(framep == NULL) 
-        { // It's a miss, kill our victim, need to swap
-
-
-			/*
-			 * search swap list, if hit in swap, swap-in, else swap-out
-			 * in this implementation, DAX is not supported. 
-			 * victim is pointing to memory page to be evicted. 
-			 * 1. add victim to victim list
-			 * 1.2. check swap_list and swap-in if found in swap_list
-			 * 1.3. if hit in swap, renew the reference time in swap.
-			 * 1.5. if miss in swap, swap-out victim page to swap_list
-			 * 2. change victim page's value to referenced page
-			 */
-
-
-			if(debug_flag) printf("Victim selected: %d, Page: %d\n", victim->index, victim->page);
-			add_victim(&data->victim_list, victim);
-
-
-			/*
-			if(swap_in(&data->swap_list)==1) // last_page_ref is found in swap_list
-				data->swap_in++;
-			else
-			{
-				swap_out(&data->swap_list, victim);
-				data->swap_out++;
-			}
-			*/
-
-			victim->page = last_page_ref;
-			clock_gettime(CLOCK_REALTIME,&victim->time );
-			victim->extra = counter;
-			fault = 1;
-
-
-        }
-        else if(framep->page == -1)
-        { // Can use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-                fault = 1;
+        int jobs = _jobs > 0 ? _jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        int running = 0, next = 0, done = 0, run = 0, status = 0, fds[2];
+        size_t want = sizeof(size_t) * 2 * num_algos, got = 0;
+        ssize_t n = 0;
+        pid_t pid = 0, *pids = calloc(runs, sizeof(pid_t));
+        int *pipes = calloc(runs, sizeof(int));
+        if(pids == NULL || pipes == NULL)
+        {
+                perror("run_workers()");
+                exit(-1);
         }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
+        fflush(NULL); // or the workers flush what's buffered again
+        while(done < runs)
+        {
+                for(; running < (jobs > 0 ? jobs : 1) && next < runs; next++, running++)
+                {
+                        if(pipe(fds) != 0 || (pid = fork()) < 0)
+                        {
+                                perror("run_workers()");
+                                exit(-1);
+                        }
+                        if(pid == 0)
+                        {
+                                close(fds[0]);
+                                run_worker(next, setup, fds[1]);
+                        }
+                        close(fds[1]);
+                        pids[next] = pid;
+                        pipes[next] = fds[0];
+                }
+                pid = wait(&status);
+                for(run = 0; run < next && pids[run] != pid; run++)
+                        ;
+                if(run == next)
+                        continue;
+                for(got = 0; got < want; got += n)
+                {
+                        n = read(pipes[run], (char *)counts[run] + got, want - got);
+                        if(n <= 0)
+                                break;
+                }
+                close(pipes[run]);
+                pids[run] = 0;
+                running--;
+                done++;
+                if(got < want || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                        break;
         }
-
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-				if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-				if(fault == 1) data->misses++; else data->hits++;
-
-        return fault;
+        if(done < runs)
+                for(n = 0; n < next; n++)
+                        if(pids[n] > 0)
+                                kill(pids[n], SIGTERM);
+        free(pids);
+        free(pipes);
+        return done < runs ? run : -1;
 }
 
+static unsigned int repeat_seed; // seed of the first --repeat run
 
+static void repeat_setup(int run)
+{
+        _seed = repeat_seed + run;
+        _seed_set = 1;
+}
 
 /**
- * int LRU(Algorithm_Data *data)
+ * int repeat_runs()
  *
- * LRU Page Replacement Algorithm
+ * --repeat N: N runs seeded _seed, _seed + 1... (the clock without
+ * --seed), --jobs at a time, then the mean, standard deviation and 95%
+ * confidence interval of each policy's hit ratio.
  *
- * @param *data {Algorithm_Data} struct holding algorithm data
- *
- * return {int} did page fault, 0 or 1
+ * @return 0
  */
-int LRU(Algorithm_Data *data)
+int repeat_runs()
 {
-        struct Frame *framep = data->page_table.lh_first, // lh_first = first element of queue 
-                     *victim = NULL;
-
-        int fault = 0;
-		data->total_ref_count++;
-
-		/*
-		 *  search page table for the frame holding referenced page. 
-		 */
-        while (framep != NULL && 
-				framep->page > -1 && 
-				framep->page != last_page_ref) {
-
-                if(victim == NULL || 
-					compare_time(framep->time, victim->time)==-1)
-				{
-                        victim = framep; // No victim yet or frame older than victim
-				}
-                framep = framep->frames.le_next;
-
-        }
-
-        /* Make a decision */
-        if(framep == NULL) 
-        { // It's a miss, kill our victim, need to swap
-
-
-			/*
-			 * search swap list, if hit in swap, swap-in, else swap-out
-			 * in this implementation, DAX is not supported. 
-			 * victim is pointing to memory page to be evicted. 
-			 * 1. add victim to victim list
-			 * 1.2. check swap_list and swap-in if found in swap_list
-			 * 1.3. if hit in swap, renew the reference time in swap.
-			 * 1.5. if miss in swap, swap-out victim page to swap_list
-			 * 2. change victim page's value to referenced page
-			 */
-
-
-			if(debug_flag) printf("Victim selected: %d, Page: %d\n", victim->index, victim->page);
-			add_victim(&data->victim_list, victim);
-
-
-			/*
-			if(swap_in(&data->swap_list)==1) // last_page_ref is found in swap_list
-				data->swap_in++;
-			else
-			{
-				swap_out(&data->swap_list, victim);
-				data->swap_out++;
-			}
-			*/
-
-			victim->page = last_page_ref;
-			clock_gettime(CLOCK_REALTIME,&victim->time );
-			victim->extra = counter;
-			fault = 1;
-
-
+        int run = 0, jobs = _jobs > 0 ? _jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        size_t i = 0;
+        size_t (*counts)[MAX_POLICIES][2] = calloc(_repeat, sizeof(*counts));
+        struct timespec ts;
+        uint64_t t0 = now_ns();
+        check_worker_options("--repeat");
+        if(counts == NULL)
+        {
+                perror("repeat_runs()");
+                exit(-1);
         }
-        else if(framep->page == -1)
-        { // Can use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-                fault = 1;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        repeat_seed = _seed_set ? _seed : (unsigned int)ts.tv_nsec;
+        run = run_workers(_repeat, repeat_setup, counts);
+        if(run >= 0)
+        {
+                fprintf(stderr, "[ERR] run %d of --repeat (--seed %u) failed\n", run + 1, repeat_seed + run);
+                exit(-1);
         }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
+        printf("Runs: %d, seeds %u..%u, %d at a time, %.3f s\n", _repeat, repeat_seed, repeat_seed + _repeat - 1,
+                        jobs < _repeat ? jobs : _repeat,
+                        (now_ns() - t0) / 1e9);
+        for(i = 0; i < num_algos; i++)
+        {
+                double sum = 0, sq = 0, mean = 0, sd = 0, half = 0, ratio = 0;
+                if(algos[i].selected != 1)
+                        continue;
+                for(run = 0; run < _repeat; run++)
+                {
+                        ratio = counts[run][i][0] + counts[run][i][1] > 0 ?
+                                (double)counts[run][i][0] / (counts[run][i][0] + counts[run][i][1]) : 0.0;
+                        sum += ratio;
+                        sq += ratio * ratio;
+                }
+                mean = sum / _repeat;
+                sd = sqrt(fmax(0, (sq - sum * mean) / (_repeat - 1)));
+                half = t_975(_repeat - 1) * sd / sqrt(_repeat);
+                printf("%s Algorithm\n", algos[i].policy->label);
+                printf("Frames in Mem: %d, Hit Ratio: mean %f, stddev %f, 95%% CI [%f, %f]\n",
+                                num_frames, mean, sd, mean - half, mean + half);
         }
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-	        if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-	        if(fault == 1) data->misses++; else data->hits++;
+        free(counts);
+        return 0;
+}
+
+static Sweep sweep; // the --sweep grid
+static long *shard_points; // its points on this --shard, by worker run
 
-        return fault;
+static void sweep_setup(int run)
+{
+        Sweep_Point pt;
+        sweep_point(&sweep, shard_points[run], &pt);
+        num_frames = pt.frames;
+        _num_of_hotpages = pt.hotness;
+        _window_size = pt.window;
+        _head_hot = strcmp(pt.dist, "head") == 0;
+        _tail_hot = strcmp(pt.dist, "tail") == 0;
+        _mid_hot = strcmp(pt.dist, "mid") == 0;
+        _dual_head_hot = strcmp(pt.dist, "dual") == 0;
+        _zipf_s = strncmp(pt.dist, "zipf:", 5) == 0 ? atof(pt.dist + 5) : 0;
+        _seed_set = 1;
 }
 
 /**
- * int CLOCK(Algorithm_Data *data)
+ * int sweep_runs()
  *
- * CLOCK Page Replacement Algorithm
+ * --sweep: run this --shard's points of the grid, --jobs at a time, and
+ * write their result file (see sweep.h) to --sweep_file or stdout. Every
+ * point runs on the same seed, so which shard or machine runs it doesn't
+ * change its numbers.
  *
- * @param *data {Algorithm_Data} struct holding algorithm data
- *
- * return {int} did page fault, 0 or 1
+ * @return 0
  */
-int CLOCK(Algorithm_Data *data)
+int sweep_runs()
 {
-        static Frame *clock_hand = NULL; // Clock needs a hand
-        Frame *framep = data->page_table.lh_first;
-        int fault = 0;
-		data->total_ref_count++;
-        /* Forward traversal. */
-        /* Find target (hit), empty page slot (miss), or victim to evict (miss) */
-        while(framep != NULL && framep->page > -1 && framep->page != last_page_ref)
-                framep = framep->frames.le_next;
-        /* Make a decision */
-        if(framep != NULL)
+        char dist[SWEEP_DIST_LEN];
+        size_t (*counts)[MAX_POLICIES][2] = NULL;
+        struct timespec ts;
+        Sweep_Point pt;
+        FILE *fp = stdout;
+        long p = 0;
+        int runs = 0, run = 0;
+        size_t i = 0;
+        check_worker_options("--sweep");
+        if(_shard_count > 1 && !_seed_set)
         {
-                if(framep->page == -1)
-                {
-                        framep->page = last_page_ref;
-                        framep->extra = 0;
-                        fault = 1;
-                }
-                else
-                { // Found the page, update its R bit to 0
-                        framep->extra = 0;
-                }
+                fprintf(stderr, "[ERR] --shard needs a --seed, the shards must run the same traces\n");
+                exit(-1);
         }
-        else // Use the hand to find our victim
+        if(_zipf_s > 0)
+                snprintf(dist, sizeof(dist), "zipf:%g", _zipf_s);
+        else
+                snprintf(dist, sizeof(dist), "%s", _head_hot ? "head" : _tail_hot ? "tail" :
+                                _mid_hot ? "mid" : _dual_head_hot ? "dual" : "uniform");
+        if(sweep_parse(&sweep, _sweep_spec, num_frames, _num_of_hotpages, _window_size, dist) != 0)
+                exit(-1);
+        shard_points = malloc(sizeof(long) * (sweep.points / _shard_count + 1));
+        counts = calloc(sweep.points / _shard_count + 1, sizeof(*counts));
+        if(shard_points == NULL || counts == NULL)
+        {
+                perror("sweep_runs()");
+                exit(-1);
+        }
+        for(p = _shard_index; p < sweep.points; p += _shard_count)
+                if(sweep_point(&sweep, p, &pt))
+                        shard_points[runs++] = p;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        if(!_seed_set)
+                _seed = (unsigned int)ts.tv_nsec;
+        fprintf(stderr, ">>> sweep of %ld points, %d of them on shard %d/%d\n", sweep.runs, runs,
+                        _shard_index, _shard_count);
+        run = run_workers(runs, sweep_setup, counts);
+        if(run >= 0)
+        {
+                sweep_point(&sweep, shard_points[run], &pt);
+                fprintf(stderr, "[ERR] sweep point %ld (-f %d -h %d -w %d %s) failed\n", shard_points[run],
+                                pt.frames, pt.hotness, pt.window, pt.dist);
+                exit(-1);
+        }
+        if(strlen(_sweep_file) > 0 && (fp = fopen(_sweep_file, "w")) == NULL)
+        {
+                fprintf(stderr, "[ERR] cannot write %s\n", _sweep_file);
+                exit(-1);
+        }
+        fprintf(fp, SWEEP_MAGIC "\n# options:%s\n# seed: %u\n# sweep: %s\n# points: %ld\n# shard: %d/%d\n"
+                        SWEEP_COLUMNS "\n", run_args, _seed, _sweep_spec, sweep.runs, _shard_index, _shard_count);
+        for(run = 0; run < runs; run++)
         {
-                while(clock_hand == NULL || clock_hand->extra == 0)
+                sweep_point(&sweep, shard_points[run], &pt);
+                for(i = 0; i < num_algos; i++)
                 {
-                        if(clock_hand == NULL)
-                        {
-                                clock_hand = data->page_table.lh_first;
-                        }
-                        else
-                        {
-                                clock_hand->extra = 1;
-                                clock_hand = clock_hand->frames.le_next;
-                        }
+                        if(algos[i].selected != 1)
+                                continue;
+                        fprintf(fp, "%ld,%d,%d,%d,%s,%s,%zu,%zu,%f\n", shard_points[run], pt.frames, pt.hotness,
+                                        pt.window, pt.dist, algos[i].policy->label, counts[run][i][0], counts[run][i][1],
+                                        counts[run][i][0] + counts[run][i][1] > 0 ? (double)counts[run][i][0] /
+                                        (counts[run][i][0] + counts[run][i][1]) : 0.0);
                 }
-                add_victim(&data->victim_list, clock_hand);
-                clock_hand->page = last_page_ref;
-                clock_hand->extra = 0;
-                fault = 1;
         }
-		if(_window_size>0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-    	    if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-    	    if(fault == 1) data->misses++; else data->hits++;
-
-        return fault;
+        if(fp != stdout)
+                fclose(fp);
+        free(shard_points);
+        free(counts);
+        return 0;
 }
 
 /**
- * int NFU(Algorithm_Data *data)
- *
- * NFU Page Replacement Algorithm
+ * int get_ref()
  *
- * @param *data {Algorithm_Data} struct holding algorithm data
+ * get a random ref
  *
- * return {int} did page fault, 0 or 1
+ * @return {int}
  */
-int NFU(Algorithm_Data *data)
+int get_ref()
 {
-        struct Frame *framep = data->page_table.lh_first,
-                     *victim = NULL;
-        int fault = 0;
-		data->total_ref_count++;
-
-        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
-        while (framep != NULL && framep->page > -1 && framep->page != last_page_ref) {
-                if(victim == NULL || framep->extra < victim->extra)
-                        victim = framep; // No victim or frame used fewer times
-                framep = framep->frames.le_next;
-        }
-        /* Make a decision */
-        if(framep == NULL)
-        { // It's a miss, kill our victim
-                add_victim(&data->victim_list, victim);
-                victim->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&victim->time );
-                victim->extra = 0;
-                fault = 1;
-        }
-        else if(framep->page == -1)
-        { // Can use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = 0;
-                fault = 1;
+        if (counter < page_ref_trace_len)
+        { // next ref in the trace
+                return page_ref_trace[counter];
         }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra++;
+        else
+        { // just in case
+                return rand() % page_ref_upper_bound;
         }
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-	        if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-	        if(fault == 1) data->misses++; else data->hits++;
-
-        return fault;
 }
 
 /**
- * int AGING(Algorithm_Data *data)
+ * void policy_register(const Policy *policy)
  *
- * AGING Page Replacement Algorithm
+ * Add a policy to algos[], kept sorted by order. Called by the
+ * constructors REGISTER_POLICY() defines, before main() runs.
  *
- * @param *data {Algorithm_Data} struct holding algorithm data
- *
- * return {int} did page fault, 0 or 1
+ * @param policy {const Policy*} policy to add
  */
-int AGING(Algorithm_Data *data)
+void policy_register(const Policy *policy)
 {
-        struct Frame *framep = data->page_table.lh_first,
-                     *victim = NULL;
-        int fault = 0;
-		data->total_ref_count++;
-
-        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
-        while (framep != NULL && framep->page > -1 && framep->page != last_page_ref) {
-                framep->extra /= 2;
-                if(victim == NULL || framep->extra < victim->extra)
-                        victim = framep; // No victim or frame used rel less
-                framep = framep->frames.le_next;
-        }
-        /* Make a decision */
-        if(framep == NULL)
-        { // It's a miss, kill our victim
-                add_victim(&data->victim_list, victim);
-                victim->page = last_page_ref;
-                clock_gettime(CLOCK_REALTIME, &victim->time);
-                victim->extra = 0;
-                fault = 1;
-        }
-        else if(framep->page == -1)
-        { // Can use free page table index
-                framep->page = last_page_ref;
-                clock_gettime(CLOCK_REALTIME, &framep->time);
-                framep->extra = 0;
-                fault = 1;
+        size_t i = num_algos;
+        if(num_algos == MAX_POLICIES)
+        {
+                fprintf(stderr, "[ERR] too many policies, raise MAX_POLICIES\n");
+                exit(-1);
         }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-                clock_gettime(CLOCK_REALTIME, &framep->time);
-                framep->extra = framep->extra+10000000;
-                while (framep->frames.le_next != NULL) {
-                        framep = framep->frames.le_next;
-                        framep->extra /= 2;
-                }
+        while(i > 0 && algos[i - 1].policy->order > policy->order)
+        {
+                algos[i] = algos[i - 1];
+                i--;
         }
-
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-    	    if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-    	    if(fault == 1) data->misses++; else data->hits++;
-
-        return fault;
+        algos[i].policy = policy;
+        algos[i].selected = 0;
+        algos[i].data = NULL;
+        algos[i].baseline = NULL;
+        num_algos++;
 }
 
-int LRU2(Algorithm_Data *data)
+/*
+ * run one ref through an algorithm and count the hit or miss if it is
+ * in the algorithm's counted_range()
+ */
+static void page_algo(Algorithm *algo, int page_ref)
 {
-        struct Frame *framep = data->page_table.lh_first, // lh_first = first element of queue 
-                     *victim = NULL;
-
+        Algorithm_Data *data = algo->data;
         int fault = 0;
-		int k_value = 2;
-		struct Page_Log* page=NULL;
-
-		/*
-		 *  search page table for the frame holding referenced page. 
-		 */
-		int max_distance = 0;
-		int tmp_d=0;
-		int tmp_dk=0;
-		int tmp_k=1;
-		int use_lru=0;
-//		fprintf(stderr, "current reference page = %d\n", last_page_ref);
-		data->total_ref_count++;
-
-			/*
-			 * add to log
-			 */
-		page = malloc(sizeof(Page_Log));
-		page->page_num = last_page_ref;
-		TAILQ_INSERT_TAIL(&data->page_window_log, page, pages);
-
-		struct Page_Log *pg = NULL;
-        while (framep != NULL && 
-				framep->page > -1 && 
-				framep->page != last_page_ref) 
-		{
-			tmp_d = 0;
-			tmp_dk= 0;
-			tmp_k = 0;
-			// run through log and find k-th furthest page
-			TAILQ_FOREACH_REVERSE(pg, &data->page_window_log, Page_Win_List, pages)
-			{
-				tmp_d++;
-//				fprintf(stderr, "%d ", pg->page_num);
-				if(framep->page == pg->page_num)
-				{
-					tmp_k++;
-					tmp_dk=tmp_d;
-				}
-
-				if(tmp_k==k_value)
-				{
-					use_lru=0;
-					break;
-				}
-				else
-					use_lru=1;
-			}
-
-			if(use_lru)
-			{
-				victim= NULL;
-				break;
-			}
-
-			if(max_distance < tmp_dk)
-			{
-				max_distance = tmp_dk;
-				victim = framep;
-//				fprintf(stderr, "page %d distance %d \n", framep->page, max_distance);
-			}
-
-            framep = framep->frames.le_next;
-        }
-
-
-		// if victim is not found, use LRU
-		if(victim==NULL)
-		{
-			//fprintf(stderr, "Using LRU in LRU2!!!\n");
-			framep = data->page_table.lh_first;
-    	    while (	framep != NULL && 
-					framep->page > -1 && 
-					framep->page != last_page_ref) 
-			{
-					if(victim == NULL ||
-						compare_time(framep->time, victim->time)==-1)
-					{
-    	                    victim = framep; // No victim yet or frame older than victim
-					}
-            framep = framep->frames.le_next;
-			}
-		}
-
-
-        /* Make a decision */
-        if(framep == NULL) 
-        { // It's a miss, kill our victim, need to swap
-
-			if(debug_flag) printf("Victim selected: %d, Page: %d\n", victim->index, victim->page);
-			add_victim(&data->victim_list, victim);
-
-			victim->page = last_page_ref;
-			clock_gettime(CLOCK_REALTIME,&victim->time );
-			victim->extra = counter;
-			fault = 1;
-
-
-        }
-        else if(framep->page == -1)
-        { // Can use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-                fault = 1;
+        size_t lo = 0, hi = 0;
+        uint64_t t0 = 0;
+        uint64_t before[PERF_NUM_COUNTERS], after[PERF_NUM_COUNTERS];
+        if(perf.n > 0)
+                perf_counters_read(&perf, before);
+        t0 = now_ns();
+        data->total_ref_count++;
+        fault = algo->policy->access(data, page_ref, 0);
+        if(debug_flag && algo->policy->dump != NULL)
+                algo->policy->dump(data, page_ref);
+        if(data->prefetch != NULL)
+                prefetch_ref(data->prefetch, data, algo->policy->access, page_ref, fault);
+        add_timed_run(&data->timing, 1, fault, now_ns() - t0);
+        data->faults += fault;
+        if(perf.n > 0)
+        {
+                perf_counters_read(&perf, after);
+                add_perf(data->timing.perf, before, after);
         }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
+        counted_range(algo, &lo, &hi);
+        if(algo->baseline != NULL)
+        {
+                algo->baseline->total_ref_count++;
+                if(algo->policy->access(algo->baseline, page_ref, 0) == 1)
+                {
+                        algo->baseline->faults++;
+                        if(data->total_ref_count - 1 >= lo && data->total_ref_count - 1 < hi)
+                                algo->baseline->misses++;
+                }
+                else if(data->total_ref_count - 1 >= lo && data->total_ref_count - 1 < hi)
+                        algo->baseline->hits++;
         }
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-	        if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-	        if(fault == 1) data->misses++; else data->hits++;
-
-        return fault;
+        if(data->total_ref_count - 1 < lo || data->total_ref_count - 1 >= hi)
+                return;
+        if(fault == 1) data->misses++; else data->hits++;
 }
 
-int LRU3(Algorithm_Data *data)
+/**
+ * int page()
+ *
+ * page all selected algorithms with input ref
+ *
+ * @param page_ref {int} referenced page number
+ *
+ * @return 0
+ */
+int page(int page_ref)
 {
-        struct Frame *framep = data->page_table.lh_first, // lh_first = first element of queue 
-                     *victim = NULL;
-
-        int fault = 0;
-		int k_value = 3;
-		struct Page_Log* page=NULL;
-		data->total_ref_count++;
-
-			/*
-			 * add to log
-			 */
-		page = malloc(sizeof(Page_Log));
-		page->page_num = last_page_ref;
-		TAILQ_INSERT_TAIL(&data->page_window_log, page, pages);
-
-		/*
-		 *  search page table for the frame holding referenced page. 
-		 */
-		int max_distance = 0;
-		int tmp_d=0;
-		int tmp_dk=0;
-		int tmp_k=1;
-		int use_lru = 0;
-//		fprintf(stderr, "current reference page = %d\n", last_page_ref);
-		struct Page_Log *pg = NULL;
-        while (framep != NULL && 
-				framep->page > -1 && 
-				framep->page != last_page_ref) 
-		{
-			tmp_d = 0;
-			tmp_dk= 0;
-			tmp_k = 0;
-			TAILQ_FOREACH_REVERSE(pg, &data->page_window_log, Page_Win_List, pages)
-			{
-				tmp_d++;
-//				fprintf(stderr, "%d ", pg->page_num);
-				if(framep->page == pg->page_num)
-				{
-					tmp_k++;
-					tmp_dk=tmp_d;
-				}
-
-				if(tmp_k==k_value)
-				{
-					use_lru = 0;
-					break;
-				}
-				else
-					use_lru=1;
-
-			}
-
-			if(use_lru)
-			{
-				victim= NULL;
-				break;
-			}
-
-//			fprintf(stderr, "\n");
-
-			/*
-			if(tmp_dk != tmp_d)
-				tmp_dk = tmp_d;
-				*/
-
-			if(tmp_k > 1 && max_distance < tmp_dk)
-			{
-				max_distance = tmp_dk;
-				victim = framep;
-//				fprintf(stderr, "page %d distance %d \n", framep->page, max_distance);
-			}
-
-            framep = framep->frames.le_next;
+        last_page_ref = page_ref;
+        size_t i = 0;
+        for (i = 0; i < num_algos; i++)
+        {
+                if(algos[i].selected==1) {
+                        page_algo(&algos[i], page_ref);
+                        if(printrefs == 1)
+                                print_stats(algos[i]);
+                }
         }
 
+        return 0;
+}
 
+int export(size_t counter, int page_num)
+{
+	if(!_export)
+		return 0;
+	if(_fp==NULL)
+		_fp = fopen(EXPORT_FILE, "w+");
 
-		// if victim is not found, use LRU
-		if(victim==NULL)
-		{
-			framep = data->page_table.lh_first;
-    	    while (	framep != NULL && 
-					framep->page > -1 && 
-					framep->page != last_page_ref) 
-			{
-					if(victim == NULL ||
-						compare_time(framep->time, victim->time)==-1)
-					{
-    	                    victim = framep; // No victim yet or frame older than victim
-					}
-            framep = framep->frames.le_next;
-			}
-		}
-
-
-        /* Make a decision */
-        if(framep == NULL) 
-        { // It's a miss, kill our victim, need to swap
-
-			if(debug_flag) printf("Victim selected: %d, Page: %d\n", victim->index, victim->page);
-			add_victim(&data->victim_list, victim);
-
-			victim->page = last_page_ref;
-			clock_gettime(CLOCK_REALTIME,&victim->time );
-			victim->extra = counter;
-			fault = 1;
 
+	fprintf(_fp, "%zu,%d\n", counter, page_num);
 
-        }
-        else if(framep->page == -1)
-        { // Can use free page table index
-                framep->page = last_page_ref;
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-                fault = 1;
-        }
-        else if(framep->page == last_page_ref)
-        { // The page was found! Hit!
-				clock_gettime(CLOCK_REALTIME,&framep->time );
-                framep->extra = counter;
-        }
-		if(_window_size > 0)
-		{
-			if(data->total_ref_count >= _window_size && 
-					(data->total_ref_count + _window_size) < max_page_calls )
-			{
-	        if(fault == 1) data->misses++; else data->hits++;
-			}
-		}
-		else
-	        if(fault == 1) data->misses++; else data->hits++;
 
-        return fault;
+	return 0;
 }
 
+/**
+ * int add_victim(Algorithm_Data *data, int index)
+ *
+ * Account for a frame evicted from page table
+ *
+ * @param data {Algorithm_Data} algorithm the frame belongs to
+ * @param index {int} page table index of the evicted frame
+ *
+ * @retun 0
+ */
+int add_victim(Algorithm_Data *data, int index)
+{
+        if(debug_flag)
+                printf("Victim index: %d, Page: %d\n", index, data->page_table.page[index]);
+        data->evictions++;
+        if(data->prefetch != NULL)
+                prefetch_evicted(data->prefetch, data->page_table.page[index]);
+        return 0;
+}
 
 
 /**
@@ -1853,6 +2190,37 @@ void print_help(const char *binary)
         printf( "   -d - verbose debugging output {1 or 0}\n");
         printf( "   -r - verbose debugging output {1 or 0}\n");
         printf( "   -d - verbose debugging output {1 or 0}\n");
+        printf( "   --scan len      - mix sequential scans of len pages into generated refs\n");
+        printf( "   --scan_pct pct  - percentage of generated refs that are scans {0..100}\n");
+        printf( "   --timing        - print time, throughput and hit/miss path cost per algorithm\n");
+        printf( "   --perf          - --timing plus hardware counters (cycles, LLC/branch misses...)\n");
+        printf( "   --stats_file f  - write the summaries and timings to f as CSV\n");
+        printf( "   -w n            - LOG's history length, and refs left uncounted at both ends\n");
+        printf( "   --warmup n      - replay n refs before counting hits/misses, for every algorithm\n");
+        printf( "   --measure m     - count m refs after the warm-up, then stop\n");
+        printf( "   --interval n    - hit ratio, miss rate and evictions of each algorithm every n refs\n");
+        printf( "   --series_file f - write the --interval time series to f instead of stdout\n");
+        printf( "   --zipf s        - generate Zipf distributed refs with exponent s\n");
+        printf( "   --seed n        - seed the generator, for reproducible traces\n");
+        printf( "   --save_trace f  - write the refs to f for -t, binary if f ends in .bin\n");
+        printf( "   --addr_trace f  - byte addresses (lackey, text or binary u64) instead of -t\n");
+        printf( "   --page_size s   - page sizes for --addr_trace, e.g. \"4K,64K,2M\", default 4K\n");
+        printf( "   --fit_model f   - write a reuse distance model of the trace to f\n");
+        printf( "   --model f       - generate the refs from a --fit_model file, LRU behaves the same\n");
+        printf( "   --gen_threads n - threads generating from --model, default one per CPU\n");
+        printf( "   --prefetch mode - readahead in front of each policy: next, stride or adaptive\n");
+        printf( "   --prefetch_n n  - pages (next) or strides (stride, adaptive) to read ahead, default 4\n");
+        printf( "   --repeat n      - n runs with seeds --seed, --seed + 1..., mean and 95%% CI of each hit ratio\n");
+        printf( "   --jobs n        - --repeat runs or --sweep points at a time, default one per CPU\n");
+        printf( "   --sweep grid    - run a grid, e.g. \"f=10,100;h=10,20;w=0,50;dist=uniform,zipf:0.9\"\n");
+        printf( "   --shard i/N     - run only the sweep points numbered i modulo N\n");
+        printf( "   --sweep_file f  - write the sweep results (or the --merge) to f instead of stdout\n");
+        printf( "   --merge files   - merge --sweep result files of the shards into one\n");
+        printf( "   --analyze       - footprint, reuse distances, gaps and hotness of the trace, no simulation\n");
+        printf( "   --analyze_threads n - threads for --analyze, default one per CPU, same report\n");
+        printf( "   --checkpoint f  - save the simulator state to f at the end of the run\n");
+        printf( "   --checkpoint_every n - also save it every n refs\n");
+        printf( "   --restore f     - resume from a --checkpoint file, same trace and options\n");
 		exit(0);
 }
 
@@ -1864,7 +2232,7 @@ void print_help(const char *binary)
 int print_stats(Algorithm algo)
 {
         print_summary(algo);
-        print_list(algo.data->page_table.lh_first, "Frame #", "Page Ref");
+        print_list(&algo.data->page_table, "Frame #", "Page Ref");
         return 0;
 }
 
@@ -1875,16 +2243,40 @@ int print_stats(Algorithm algo)
  */
 int print_summary(Algorithm algo)
 {
-        printf("%s Algorithm\n", algo.label);
+        printf("%s Algorithm\n", algo.policy->label);
         printf("Frames in Mem: %d, ", num_frames);
-        printf("Hits: %d, ", algo.data->hits);
-        printf("Misses: %d, ", algo.data->misses);
+        printf("Hits: %zu, ", algo.data->hits);
+        printf("Misses: %zu, ", algo.data->misses);
 		/*
         printf("Swap out: %zu, ", algo.data->swap_out);
         printf("Swap in: %zu, ", algo.data->swap_in);
         printf("Swap I/O: %zu, ", algo.data->swap_out + algo.data->swap_in);
 		*/
         printf("Hit Ratio: %f\n", (double)algo.data->hits/(double)(algo.data->hits+algo.data->misses));
+        if(algo.data->prefetch != NULL)
+        {
+                const Prefetcher *pf = algo.data->prefetch;
+                printf("Prefetch: %zu issued, %zu useful (%.1f%%), %zu wasted (%zu not in the trace), %zu unused\n",
+                                pf->issued, pf->useful, pf->issued ? 100.0 * pf->useful / pf->issued : 0.0,
+                                pf->wasted, pf->absent, prefetch_unused(pf));
+                if(algo.baseline != NULL)
+                        printf("Demand misses: %zu, %zu without prefetch (%+.1f%%)\n", algo.data->misses,
+                                        algo.baseline->misses, algo.baseline->misses ?
+                                        100.0 * ((double)algo.data->misses - algo.baseline->misses) / algo.baseline->misses : 0.0);
+        }
+        if(_print_timing)
+        {
+                const Algo_Timing *t = &algo.data->timing;
+                double hit_ns = 0, miss_ns = 0;
+                printf("Time: %.3f ms, ", t->ns / 1e6);
+                printf("Refs/s: %.0f, ", t->ns ? algo.data->total_ref_count * 1e9 / t->ns : 0.0);
+                if(timing_split(t, &hit_ns, &miss_ns) == 0)
+                        printf("Hit path: %.1f ns, Miss path: %.1f ns\n", hit_ns, miss_ns);
+                else
+                        printf("Hit path: -, Miss path: -\n");
+                if(perf.n > 0)
+                        print_perf("Counters", t->perf, algo.data->total_ref_count);
+        }
 //		printf("swap on HDD takes %f mu-seconds\n", (double) (HDD_READ_LATENCY * algo.data->swap_in + HDD_WRITE_LATENCY * algo.data->swap_out));
 //		printf("swap on SSD takes %f mu-seconds\n", (double) (SSD_READ_LATENCY * algo.data->swap_in + SSD_WRITE_LATENCY * algo.data->swap_out));
 //		printf("swap on PCM takes %f mu-seconds\n", (double) (1000*PCM_READ_LATENCY * (double)algo.data->swap_in + 1000*PCM_WRITE_LATENCY * (double)algo.data->swap_out)/1000);
@@ -1892,21 +2284,76 @@ int print_summary(Algorithm algo)
         return 0;
 }
 
+/**
+ * int write_stats_file(const char *path)
+ *
+ * Write one CSV row per selected algorithm with its summary and timings,
+ * for comparing runs and builds
+ *
+ * @param path {const char*} file to (over)write
+ *
+ * @return 0, -1 if the file can't be opened
+ */
+int write_stats_file(const char *path)
+{
+        FILE *fp = fopen(path, page_size_run > 0 ? "a" : "w"); // later page sizes add rows
+        size_t i = 0;
+        int c = 0;
+        long rss = peak_rss_kb();
+        if(fp == NULL)
+        {
+                perror("write_stats_file()");
+                return -1;
+        }
+        if(page_size_run <= 0)
+                fprintf(fp, "algorithm,frames,refs,hits,misses,hit_ratio,time_ns,refs_per_sec,"
+                                "hit_ns,miss_ns,peak_rss_kb,cycles_per_mref,instructions_per_mref,"
+                                "llc_misses_per_mref,branch_misses_per_mref,page_faults_per_mref,page_size\n");
+        for (i = 0; i < num_algos; i++)
+        {
+                const Algorithm_Data *data = algos[i].data;
+                const Algo_Timing *t = &data->timing;
+                double hit_ns = 0, miss_ns = 0;
+                if(algos[i].selected != 1)
+                        continue;
+                timing_split(t, &hit_ns, &miss_ns); // 0, 0 when they can't be told apart
+                fprintf(fp, "%s,%d,%zu,%zu,%zu,%f,%llu,%.0f,%.1f,%.1f,%ld",
+                                algos[i].policy->label, num_frames, data->total_ref_count,
+                                data->hits, data->misses,
+                                (double)data->hits / (double)(data->hits + data->misses),
+                                (unsigned long long)t->ns,
+                                t->ns ? data->total_ref_count * 1e9 / t->ns : 0.0,
+                                hit_ns, miss_ns, rss);
+                for(c = 0; c < PERF_NUM_COUNTERS; c++)
+                { // empty without --perf or when the counter isn't available
+                        if(perf.n > 0 && perf_counter_available(&perf, c) && data->total_ref_count > 0)
+                                fprintf(fp, ",%.0f", t->perf[c] * 1e6 / data->total_ref_count);
+                        else
+                                fprintf(fp, ",");
+                }
+                // bytes, 0 for a trace of page numbers
+                fprintf(fp, ",%llu\n", page_size_run < 0 ? 0ULL :
+                                (unsigned long long)addr_traces[page_size_run].page_size);
+        }
+        fclose(fp);
+        return 0;
+}
+
 /**
  * int print_list()
  *
  * Print list
  *
- * @param head {Frame} head of frame list
+ * @param table {Frame_Table} page table to print
  * @param index_label {const char*} label for index frame field
  * @param value_label {const char*} label for value frame field
  *
  * @retun 0
  */
-int print_list(struct Frame *head, const char* index_label, const char* value_label)
+int print_list(Frame_Table *table, const char* index_label, const char* value_label)
 {
         int colsize = 9, labelsize;
-        struct Frame *framep;
+        int framep;
         // Determine lanbel col size from text
         if (strlen(value_label) > strlen(index_label))
                 labelsize = strlen(value_label) + 1;
@@ -1914,27 +2361,27 @@ int print_list(struct Frame *head, const char* index_label, const char* value_la
                 labelsize = strlen(index_label) + 1;
         /* Forward traversal. */
         printf("%-*s: ", labelsize, index_label);
-        for (framep = head; framep != NULL; framep = framep->frames.le_next)
+        for (framep = 0; framep < table->size; framep++)
         {
-                printf("%*d", colsize, framep->index);
+                printf("%*d", colsize, framep);
         }
         printf("\n%-*s: ", labelsize, value_label);
-        for (framep = head; framep != NULL; framep = framep->frames.le_next)
+        for (framep = 0; framep < table->size; framep++)
         {
-                if(framep->page == -1)
+                if(table->page[framep] == -1)
                         printf("%*s", colsize, "_");
                 else
-                        printf("%*d", colsize, framep->page);
+                        printf("%*d", colsize, table->page[framep]);
         }
         printf("\n%-*s: ", labelsize, "Extra");
-        for (framep = head; framep != NULL; framep = framep->frames.le_next)
+        for (framep = 0; framep < table->size; framep++)
         {
-                printf("%*d", colsize, framep->extra);
+                printf("%*u", colsize, table->extra[framep]);
         }
         printf("\n%-*s: ", labelsize, "Time");
-        for (framep = head; framep != NULL; framep = framep->frames.le_next)
+        for (framep = 0; framep < table->size; framep++)
         {
-                printf("% 2d.%*lu", (int) (framep->time.tv_sec - _start_time), colsize-3, (unsigned long) (framep->time.tv_nsec/1000));
+                printf("%*llu", colsize, (unsigned long long)table->tick[framep]);
         }
         printf("\n\n");
 
@@ -1953,21 +2400,20 @@ int cleanup()
 
 	if(_fp != NULL)
 		fclose(_fp);
-
-        size_t i = 0;
-        for (i = 0; i < num_algos; i++)
-        {
-                /* Clean up memory, delete the list */
-                while (algos[i].data->page_ref_log.tqh_first != NULL)
-                        TAILQ_REMOVE(&algos[i].data->page_ref_log, algos[i].data->page_ref_log.tqh_first, pages);
-                while (algos[i].data->page_window_log.tqh_first != NULL)
-                        TAILQ_REMOVE(&algos[i].data->page_window_log, algos[i].data->page_window_log.tqh_first, pages);
-                while (algos[i].data->page_table.lh_first != NULL)
-                        LIST_REMOVE(algos[i].data->page_table.lh_first, frames);
-                while (algos[i].data->victim_list.lh_first != NULL)
-                        LIST_REMOVE(algos[i].data->victim_list.lh_first, frames);
-                while (algos[i].data->swap_list.lh_first != NULL)
-                        LIST_REMOVE(algos[i].data->swap_list.lh_first, frames);
-        }
+	free(export_buf);
+
+        int k = 0;
+        free(page_ref_trace);
+        page_ids_free(&trace_ids);
+        free(optimum_find_test);
+        free(hot_map);
+        free(zipf_cdf);
+        for (k = 0; k < num_page_sizes; k++)
+                addr_trace_free(&addr_traces[k]);
+        if(perf.n > 0)
+                perf_counters_close(&perf);
+        if(series_fp != NULL && series_fp != stdout)
+                fclose(series_fp);
+        free_algos();
         return 0;
 }
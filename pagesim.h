@@ -1,105 +1,109 @@
 #ifndef PAGESIM_H
 #define PAGESIM_H
 
+#include <stdint.h>
+#include <stddef.h>
+#include "frame_table.h"
+#include "page_map.h"
+#include "perf_counters.h"
+
 /**
- * Data structures
+ * Binary trace file: TRACE_MAGIC (8 bytes), a uint64_t ref count, then
+ * that many int32_t page numbers, all in host byte order
  */
-// List for page tables and victim lists
-LIST_HEAD(Page_Ref_List, Page_Ref) page_refs;
-// List for page tables and victim lists
-LIST_HEAD(Frame_List, Frame);
-TAILQ_HEAD(Page_List, Page_Log) page_ref_log;
-TAILQ_HEAD(Page_Win_List, Page_Log) page_window_log;
+#define TRACE_MAGIC "PGSIMTR1"
 
-// stuct to hold Page info
-typedef struct Page_Ref
-{
-        LIST_ENTRY(Page_Ref) pages; // frames node, next
-        int page_num;
-} Page_Ref;
-
-typedef struct Page_Log
-{
-        TAILQ_ENTRY(Page_Log) pages; // frames node, next
-        int page_num;
-		size_t ref_count;
-} Page_Log;
+/**
+ * Data structures
+ */
+// where an algorithm's time went, collected per timed run of refs, see replay_timed()
+typedef struct {
+        uint64_t ns; // time spent replaying refs
+        double s_rr, s_rf, s_ff, s_rt, s_ft; // least squares sums over runs of refs, faults and time
+        uint64_t perf[PERF_NUM_COUNTERS]; // performance counters over the replays, with --perf
+} Algo_Timing;
 
-// stuct to hold Frame info
-typedef struct Frame
-{
-        LIST_ENTRY(Frame) frames; // frames node, next
-        int index; // frame position in list... not really needed
-        int page; // page frame points to, -1 is empty
-        //time_t time; // time added/accessed
-		struct timespec time;
-        int extra; // extra field for per-algo use
-} Frame;
+struct Prefetcher;
 
 // stuct to hold Algorithm data
 typedef struct {
-        int hits; // number of times page was found in page table
-        int misses; // number of times page wasn't found in page table
+        size_t hits; // number of times page was found in page table
+        size_t misses; // number of times page wasn't found in page table
 		size_t swap_in;
 		size_t swap_out;
-		size_t total_ref_count;
-		size_t page_ref_log_size;
-		struct Page_List page_ref_log; // for reference rate calculation
-		struct Page_List page_window_log; // for log window history
-        struct Frame_List page_table; // List to hold frames in page table
-        struct Frame_List victim_list; // List to hold frames that were replaced in page table
-		struct Frame_List swap_list;
-        Frame *last_victim; // Holds last frame used as a victim to make inserting to victim list faster
+		size_t total_ref_count; // references seen, the policies' clock
+        Frame_Table page_table; // frames in page table, stored as parallel arrays
+        size_t evictions; // number of frames that were replaced in page table
+        size_t faults; // faults over every ref, counted by hits/misses or not
+        size_t series_refs, series_faults, series_evictions; // totals at the last time series point
+        int clock_hand; // CLOCK hand, SECOND_CHANCE queue head
+        uint64_t *ref_bits; // packed reference bits (per frame, per node for CLOCK_PRO)
+        Page_Map page_index; // page -> frame (node for CLOCK_PRO) for O(1) lookup
+        void *policy_state; // policy specific structures, see policy.h
+        struct Prefetcher *prefetch; // --prefetch stage in front of the policy, NULL without
+        Algo_Timing timing;
 } Algorithm_Data;
 
+struct Policy;
+
 // an Algorithm
 typedef struct {
-        const char *label; // Algorithm name
-        int (*algo)(Algorithm_Data *data); // Pointer to algorithm function
+        const struct Policy *policy; // registered policy, see policy.h
         int selected; // Should algorithm be run, 1 or 0
         Algorithm_Data *data; // Holds algorithm data to pass into algorithm function
+        Algorithm_Data *baseline; // the policy without --prefetch, for the demand miss reduction
 } Algorithm;
 
+/**
+ * Configuration and runtime variables shared with the policies
+ */
+extern int num_frames;
+extern int page_ref_upper_bound;
+extern long max_page_calls; // refs to replay
+extern int _window_size;
+extern long _warmup; // --warmup, -1 if not set
+extern long _measure; // --measure, -1 if not set
+extern int *page_ref_trace; // refs to replay, followed by look-ahead padding
+extern size_t page_ref_trace_len;
+extern int *optimum_find_test;
+extern Algorithm algos[]; // registered policies, see policy_register()
+extern size_t num_algos;
+
 /**
  * Init/cleanup functions
  */
 int init(); // init lists and variable, set up config defaults, and load configs
 void gen_page_refs();
-Page_Ref* gen_ref(int*, int);
+int gen_ref(int*, int); // a random page number
+int gen_model_refs(); // generate the refs from the --model file
+int read_page_refs(); // load the -t trace, text or binary
+int read_addr_refs(); // load the --addr_trace addresses as pages
+int next_page_size(); // set up the next --page_size, 0 when done
+int save_page_refs(const char *path); // write the trace for -t
+int fit_page_model(const char *path); // write a --model of the trace
 Algorithm_Data *create_algo_data_store(); // returns empty algorithm data
-Frame *create_empty_frame(int index); // returns empty frame
 int cleanup(); // frees allocated memory
 
 /**
  * Control functions
  */
 int event_loop(); // loops for each page call
+int repeat_runs(); // --repeat: runs in parallel, hit ratio mean and confidence interval
+int sweep_runs(); // --sweep: this --shard's points of the grid, see sweep.h
 int page(int page_ref); // page all algos with page ref
 int get_ref(); // get next page ref however you like
-int add_victim(struct Frame_List *victim_list, struct Frame *frame); // add victim frame to a victim list
-int export(int counter, int page_num);
+int add_victim(Algorithm_Data *data, int index); // account for a frame replaced in page table
+int export(size_t counter, int page_num);
 
 /**
  * Output functions
  */
 void print_help(const char *binary); // prints help screen
-int print_list(struct Frame *head, const char* index_label, const char* value_label); // prints a list
+void analyze_trace(); // --analyze report, see trace_stats.h
+int print_list(Frame_Table *table, const char* index_label, const char* value_label); // prints a page table
 int print_stats(Algorithm algo); // detailed stats
 int print_summary(Algorithm algo); // one line summary
-
-/**
- * Algorithm functions
- */
-int OPTIMAL(Algorithm_Data *data);
-int RANDOM(Algorithm_Data *data);
-int FIFO(Algorithm_Data *data);
-int LRU(Algorithm_Data *data);
-int CLOCK(Algorithm_Data *data);
-int NFU(Algorithm_Data *data);
-int AGING(Algorithm_Data *data);
-int LOG(Algorithm_Data *data);
-int LOG_NOWIN(Algorithm_Data *data);
-int LRU2(Algorithm_Data *data);
-int LRU3(Algorithm_Data *data);
+int write_stats_file(const char *path); // summaries and timings as CSV
+int timing_split(const Algo_Timing *timing, double *hit_ns, double *miss_ns); // hit and miss path cost
 
 #endif
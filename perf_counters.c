@@ -0,0 +1,132 @@
+/*
+   Performance counters
+   Description: perf_event_open() group of cycles, instructions, LLC
+   misses, branch misses and page faults for profiling the policies.
+   See perf_counters.h. Without Linux every counter reads as unavailable.
+ */
+#include <string.h>
+#include "perf_counters.h"
+
+const char *perf_counter_names[PERF_NUM_COUNTERS] = {
+	"cycles", "instructions", "LLC misses", "branch misses", "page faults"
+};
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static int open_counter(uint32_t type, uint64_t config, int group)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group == -1; // the leader starts the whole group
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+		PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/**
+ * int perf_counters_open(Perf_Counters *pc)
+ *
+ * Open and start the counters for the calling thread. Each counter is
+ * tried on its own, so a machine without LLC events still gets cycles.
+ *
+ * @return number of counters opened, 0 if none are available
+ */
+int perf_counters_open(Perf_Counters *pc)
+{
+	static const uint32_t types[PERF_NUM_COUNTERS] = {
+		PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+		PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE
+	};
+	static const uint64_t configs[PERF_NUM_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_SW_PAGE_FAULTS
+	};
+	int i = 0;
+	pc->leader = -1;
+	pc->n = 0;
+	for(i = 0; i < PERF_NUM_COUNTERS; i++)
+	{
+		pc->fd[i] = open_counter(types[i], configs[i], pc->leader);
+		pc->slot[i] = -1;
+		if(pc->fd[i] == -1)
+			continue;
+		if(pc->leader == -1)
+			pc->leader = pc->fd[i];
+		pc->slot[i] = pc->n++;
+	}
+	if(pc->leader != -1)
+	{
+		ioctl(pc->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(pc->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+	return pc->n;
+}
+
+void perf_counters_close(Perf_Counters *pc)
+{
+	int i = 0;
+	for(i = 0; i < PERF_NUM_COUNTERS; i++)
+	{
+		if(pc->fd[i] != -1)
+			close(pc->fd[i]);
+		pc->fd[i] = -1;
+	}
+	pc->leader = -1;
+	pc->n = 0;
+}
+
+/**
+ * void perf_counters_read(const Perf_Counters *pc, uint64_t values[])
+ *
+ * Read the running totals with one read() of the group, scaled up if
+ * the kernel had to multiplex the counters. Unavailable counters read 0.
+ */
+void perf_counters_read(const Perf_Counters *pc, uint64_t values[PERF_NUM_COUNTERS])
+{
+	uint64_t buf[3 + PERF_NUM_COUNTERS]; // nr, time enabled, time running, values
+	double scale = 1;
+	int i = 0;
+	memset(values, 0, sizeof(uint64_t) * PERF_NUM_COUNTERS);
+	if(pc->leader == -1 || read(pc->leader, buf, sizeof(buf)) <= 0)
+		return;
+	if(buf[2] > 0 && buf[2] < buf[1])
+		scale = (double)buf[1] / (double)buf[2];
+	for(i = 0; i < PERF_NUM_COUNTERS; i++)
+		if(pc->slot[i] != -1 && (uint64_t)pc->slot[i] < buf[0])
+			values[i] = (uint64_t)(buf[3 + pc->slot[i]] * scale);
+}
+
+#else
+
+int perf_counters_open(Perf_Counters *pc)
+{
+	int i = 0;
+	pc->leader = -1;
+	pc->n = 0;
+	for(i = 0; i < PERF_NUM_COUNTERS; i++)
+		pc->fd[i] = pc->slot[i] = -1;
+	return 0;
+}
+
+void perf_counters_close(Perf_Counters *pc)
+{
+	(void)pc;
+}
+
+void perf_counters_read(const Perf_Counters *pc, uint64_t values[PERF_NUM_COUNTERS])
+{
+	(void)pc;
+	memset(values, 0, sizeof(uint64_t) * PERF_NUM_COUNTERS);
+}
+
+#endif
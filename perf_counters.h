@@ -0,0 +1,42 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+
+/**
+ * Hardware performance counters of the calling thread, read through
+ * perf_event_open() as one group so all of them cover the same
+ * interval. Counters the kernel or the machine doesn't offer (no PMU in
+ * a VM, perf_event_paranoid, not Linux) are left out, and with none at
+ * all the caller falls back to timing only.
+ */
+enum
+{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_PAGE_FAULTS, // software counter, stands in for allocation
+	PERF_NUM_COUNTERS
+};
+
+typedef struct Perf_Counters
+{
+	int leader; // group leader fd, -1 when no counter could be opened
+	int fd[PERF_NUM_COUNTERS]; // -1 for a counter that isn't available
+	int slot[PERF_NUM_COUNTERS]; // position of each counter in a group read
+	int n; // counters in the group
+} Perf_Counters;
+
+extern const char *perf_counter_names[PERF_NUM_COUNTERS];
+
+int perf_counters_open(Perf_Counters *pc); // number of counters available, 0 if none
+void perf_counters_close(Perf_Counters *pc);
+void perf_counters_read(const Perf_Counters *pc, uint64_t values[PERF_NUM_COUNTERS]); // running totals
+
+static inline int perf_counter_available(const Perf_Counters *pc, int counter)
+{
+	return pc->fd[counter] != -1;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "pagesim.h"
+
+/**
+ * Page replacement policy interface.
+ *
+ * A policy only decides hits, misses and victims. The driver bumps
+ * data->total_ref_count before each access (policies use it as their
+ * clock) and does the hit/miss accounting, so access() just returns
+ * whether the reference faulted. Policy specific structures go in
+ * data->policy_state, set up by init().
+ *
+ * Each policy file registers its policies with REGISTER_POLICY(), no
+ * table or option parsing has to be edited to add one.
+ */
+typedef struct Policy
+{
+	const char *label; // name printed in the summary and accepted by -a
+	const char *alias; // another name accepted by -a, or NULL
+	int order; // position among the registered policies, keeps output order stable
+	int flags; // POLICY_* below
+	void (*init)(Algorithm_Data *data); // optional, called once the page table exists
+	int (*access)(Algorithm_Data *data, int page_ref, int is_write); // 1 on page fault
+	// optional, default is free(data->policy_state): state in one allocation needs no destroy()
+	void (*destroy)(Algorithm_Data *data);
+	// replay n refs through access(), counting hits/misses only if count; returns the faults
+	size_t (*replay)(Algorithm_Data *data, const int *refs, size_t n, int count);
+	void (*dump)(const Algorithm_Data *data, int page_ref); // optional, -d output after each ref
+	/*
+	 * Checkpoints (see checkpoint.h). A policy with policy_state gives its
+	 * size. A single allocation is saved as is and copied back, then
+	 * relink() points its arrays back into the copy. Any other state
+	 * provides state_save() to flatten it into state_size() bytes and
+	 * state_load() to rebuild it.
+	 */
+	size_t (*state_size)(const Algorithm_Data *data); // NULL: no state to save
+	void (*relink)(Algorithm_Data *data); // optional
+	void (*state_save)(const Algorithm_Data *data, void *image); // optional
+	void (*state_load)(Algorithm_Data *data, const void *image); // optional
+} Policy;
+
+#define POLICY_FULL_TRACE 1 // hits/misses count over the whole trace, even with -w
+
+#define MAX_POLICIES 64
+
+void policy_register(const Policy *policy); // add to algos[], see REGISTER_POLICY
+
+/*
+ * Replay kernel for access_fn: the whole loop over a block of refs is
+ * compiled per policy with access_fn inlined (flatten), so a replay
+ * makes no indirect call per ref. Faults are returned whether or not
+ * they are counted, the driver uses them to sample the hit and miss
+ * paths. Debug and verbose runs never get here, the driver takes the
+ * per ref path for them, so policies have no debug output of their own
+ * to test per ref: the driver prints it there, with dump() and in
+ * add_victim().
+ */
+#define POLICY_REPLAY_KERNEL(name, access_fn) \
+	__attribute__((flatten)) static size_t name##_replay(Algorithm_Data *data, \
+			const int *refs, size_t n, int count) \
+	{ \
+		size_t i = 0, faults = 0; \
+		for(i = 0; i < n; i++) \
+		{ \
+			data->total_ref_count++; \
+			faults += access_fn(data, refs[i], 0); \
+		} \
+		if(count) \
+		{ \
+			data->misses += faults; \
+			data->hits += n - faults; \
+		} \
+		return faults; \
+	}
+
+/*
+ * Define a Policy with its replay kernel and register it before main()
+ * runs, e.g. REGISTER_POLICY(lru, LRU, .label = "LRU", .order = 3)
+ */
+#define REGISTER_POLICY(name, access_fn, ...) \
+	POLICY_REPLAY_KERNEL(name, access_fn) \
+	static const Policy name##_policy = { \
+		.access = access_fn, .replay = name##_replay, __VA_ARGS__ }; \
+	__attribute__((constructor)) static void name##_register(void) \
+	{ \
+		policy_register(&name##_policy); \
+	}
+
+#endif
@@ -0,0 +1,375 @@
+/*
+   Page Replacement Algorithms: classic policies
+   Description: OPTIMAL, RANDOM, FIFO, LRU, NFU and AGING over the frame
+   table, victims are picked with its SIMD searches.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "policy.h"
+
+/**
+ * int OPTIMAL(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * OPTIMAL Page Replacement Algorithm
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int OPTIMAL(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        int framep = -1,
+            victim = -1;
+        int fault = 0;
+        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
+        framep = frame_table_find(ft, page_ref);
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, find our victim
+                size_t i,j;
+                for(i = 0; i < page_ref_upper_bound; ++i)
+                        optimum_find_test[i] = -1;
+                size_t next = data->total_ref_count; // trace index of the ref after this one
+                int all_found = 0;
+                j = 0;
+                while(all_found == 0 && next < page_ref_trace_len)
+                {
+                        int page = page_ref_trace[next++];
+                        if(optimum_find_test[page] == -1)
+                                optimum_find_test[page] = j++;
+                        all_found = 1;
+                        for(i = 0; i < page_ref_upper_bound; ++i)
+						{
+                                if(optimum_find_test[i] == -1)
+                                {
+                                        all_found = 0;
+                                        break;
+                                }
+						}
+                }
+                for(i = 0; i < ft->size; ++i)
+                {
+                        if(victim == -1 || optimum_find_test[ft->page[i]] > optimum_find_test[ft->page[victim]])
+                        { // No victim yet or page used further in future than victim
+                                victim = i;
+                        }
+                }
+                add_victim(data, victim);
+                ft->page[victim] = page_ref;
+                ft->tick[victim] = data->total_ref_count;
+                ft->extra[victim] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else if(framep == -1)
+        { // Use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+        }
+
+        return fault;
+}
+
+/*
+ * -d output of OPTIMAL and RANDOM after each ref, the frames and the
+ * ref before their last use
+ */
+static void basic_dump(const Algorithm_Data *data, int page_ref)
+{
+        const Frame_Table *ft = &data->page_table;
+        int framep = 0;
+        printf("Page Ref: %d\n", page_ref);
+        for (framep = 0; framep < ft->size; framep++)
+                printf("Slot: %d, Page: %d, Time used: %u\n", framep, ft->page[framep], ft->extra[framep]);
+}
+
+/*
+ * RANDOM keeps its own xorshift64* generator in policy_state rather than
+ * sharing rand(), so its victims can be checkpointed and restored.
+ * Seeded from rand(), so --seed still fixes them.
+ */
+static void random_init(Algorithm_Data *data)
+{
+        uint64_t *rng = malloc(sizeof(uint64_t));
+        *rng = ((uint64_t)rand() << 32 | (uint64_t)rand()) | 1; // never 0
+        data->policy_state = rng;
+}
+
+static size_t random_state_size(const Algorithm_Data *data)
+{
+        return sizeof(uint64_t);
+}
+
+static uint32_t random_next(uint64_t *rng)
+{
+        *rng ^= *rng >> 12;
+        *rng ^= *rng << 25;
+        *rng ^= *rng >> 27;
+        return (uint32_t)((*rng * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/**
+ * int RANDOM(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * RANDOM Page Replacement Algorithm
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int RANDOM(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        int framep = -1,
+            victim = -1;
+        int rand_victim = random_next(data->policy_state) % ft->size;
+        int fault = 0;
+        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
+        framep = frame_table_find(ft, page_ref);
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+                victim = rand_victim;
+                add_victim(data, victim);
+                ft->page[victim] = page_ref;
+                ft->tick[victim] = data->total_ref_count;
+                ft->extra[victim] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else if(framep == -1)
+        { // Use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+        }
+
+        return fault;
+}
+
+/**
+ * int FIFO(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * FIFO Page Replacement Algorithm
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int FIFO(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        int framep = -1,
+            victim = -1;
+        int fault = 0;
+        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
+        framep = frame_table_find(ft, page_ref);
+        /* Make a decision */
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+                // victim is the frame with the largest load time, as the
+                // timestamp scan always picked
+                victim = argmax_tick(ft->tick, ft->size);
+                add_victim(data, victim);
+                ft->page[victim] = page_ref;
+                ft->tick[victim] = data->total_ref_count;
+                ft->extra[victim] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else if(framep == -1)
+        { // Can use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->extra[framep] = data->total_ref_count - 1;
+        }
+
+        return fault;
+}
+
+/**
+ * int LRU(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * LRU Page Replacement Algorithm
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int LRU(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        int framep = -1,
+            victim = -1;
+
+        int fault = 0;
+
+		/*
+		 *  search page table for the frame holding referenced page.
+		 */
+        framep = frame_table_find(ft, page_ref);
+
+        /* Make a decision */
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+			victim = argmin_tick(ft->tick, ft->size); // frame older than all others
+
+			add_victim(data, victim);
+
+			ft->page[victim] = page_ref;
+			ft->tick[victim] = data->total_ref_count;
+			ft->extra[victim] = data->total_ref_count - 1;
+			fault = 1;
+        }
+        else if(framep == -1)
+        { // Can use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+        }
+
+        return fault;
+}
+
+/**
+ * int NFU(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * NFU Page Replacement Algorithm
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int NFU(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        int framep = -1,
+            victim = -1;
+        int fault = 0;
+
+        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
+        framep = frame_table_find(ft, page_ref);
+        /* Make a decision */
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+                victim = argmin_u32(ft->extra, ft->size); // frame used fewer times
+                add_victim(data, victim);
+                ft->page[victim] = page_ref;
+                ft->tick[victim] = data->total_ref_count;
+                ft->extra[victim] = 0;
+                fault = 1;
+        }
+        else if(framep == -1)
+        { // Can use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = 0;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep]++;
+        }
+
+        return fault;
+}
+
+/**
+ * int AGING(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * AGING Page Replacement Algorithm
+ *
+ * Every resident frame but the referenced one has its counter halved on
+ * each reference. The halving is applied lazily: extra holds the counter
+ * as of the frame's tick, its current value is extra >> (now - tick), so
+ * a hit touches one frame and only a miss walks the table.
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int AGING(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        int framep = -1,
+            victim = -1;
+        int fault = 0;
+        tick_t now = data->total_ref_count;
+
+        /* Find target (hit), empty page index (miss), or victim to evict (miss) */
+        framep = frame_table_find(ft, page_ref);
+        /* Make a decision */
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+                victim = argmin_decayed_u32(ft->extra, ft->tick, ft->size, now); // frame used rel less
+                add_victim(data, victim);
+                ft->page[victim] = page_ref;
+                ft->tick[victim] = now;
+                ft->extra[victim] = 0;
+                fault = 1;
+        }
+        else if(framep == -1)
+        { // Can use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = now;
+                ft->extra[framep] = 0;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit! It is not halved on this reference
+                uint32_t count = decay_u32(ft->extra[framep], now - 1 - ft->tick[framep]);
+                // saturate, a page hit on every ref would wrap after ~430 refs
+                ft->extra[framep] = count > UINT32_MAX - 10000000 ? UINT32_MAX : count + 10000000;
+                ft->tick[framep] = now;
+        }
+
+
+        return fault;
+}
+
+REGISTER_POLICY(optimal, OPTIMAL, .label = "OPTIMAL", .alias = "OPT", .order = 0, .dump = basic_dump)
+REGISTER_POLICY(random, RANDOM, .label = "RANDOM", .order = 1,
+                .init = random_init, .state_size = random_state_size, .dump = basic_dump)
+REGISTER_POLICY(fifo, FIFO, .label = "FIFO", .order = 2)
+REGISTER_POLICY(lru, LRU, .label = "LRU", .order = 3)
+REGISTER_POLICY(nfu, NFU, .label = "NFU", .order = 5)
+REGISTER_POLICY(aging, AGING, .label = "AGING", .order = 6)
@@ -0,0 +1,387 @@
+/*
+   Page Replacement Algorithms: CLOCK family
+   Description: CLOCK, Second-chance and CLOCK-Pro, reference bits are kept
+   in the packed ref_bits bitmap and pages found through page_index.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bitmap.h"
+#include "policy.h"
+
+/*
+ * load page_ref into frame index for the CLOCK family: the page is
+ * indexed for O(1) lookup and starts with its reference bit set
+ */
+static void clock_load(Algorithm_Data *data, int index, int page_ref)
+{
+        Frame_Table *ft = &data->page_table;
+        ft->page[index] = page_ref;
+        ft->tick[index] = data->total_ref_count;
+        page_map_put(&data->page_index, page_ref, index);
+        bitmap_set(data->ref_bits, index);
+}
+
+/**
+ * int CLOCK(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * CLOCK Page Replacement Algorithm
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int CLOCK(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        int framep = -1;
+        int fault = 0;
+        /* Find target (hit), empty page slot (miss), or victim to evict (miss) */
+        framep = page_map_get(&data->page_index, page_ref);
+        /* Make a decision */
+        if(framep == -1 && ft->used < ft->size)
+        {
+                framep = ft->used++;
+                clock_load(data, framep, page_ref);
+                fault = 1;
+        }
+        else if(framep != -1)
+        { // Found the page, set its R bit
+                bitmap_set(data->ref_bits, framep);
+        }
+        else // Use the hand to find our victim, it stays on the new page
+        {
+                data->clock_hand = bitmap_sweep(data->ref_bits, ft->size, data->clock_hand);
+                add_victim(data, data->clock_hand);
+                page_map_del(&data->page_index, ft->page[data->clock_hand]);
+                clock_load(data, data->clock_hand, page_ref);
+                fault = 1;
+        }
+
+        return fault;
+}
+
+/**
+ * int SECOND_CHANCE(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * Second-chance Page Replacement Algorithm
+ *
+ * FIFO queue of frames in load order: the head is evicted unless its R bit
+ * is set, in which case the bit is cleared and the page moves to the tail.
+ * Once the table is full the queue is a full ring, so moving the head to
+ * the tail is just advancing the head, and the ring is the frame array
+ * itself with clock_hand as the head. Unlike CLOCK the head moves past the
+ * page it just loaded, which joins the tail of the queue.
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int SECOND_CHANCE(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        int framep = -1,
+            victim = -1;
+        int fault = 0;
+        framep = page_map_get(&data->page_index, page_ref);
+        /* Make a decision */
+        if(framep == -1 && ft->used < ft->size)
+        { // Append to the queue tail
+                framep = ft->used++;
+                clock_load(data, framep, page_ref);
+                fault = 1;
+        }
+        else if(framep != -1)
+        { // The page was found! Hit! Earn it a second chance
+                bitmap_set(data->ref_bits, framep);
+        }
+        else
+        { // Pop the first page at the head that had no second chance left
+                victim = bitmap_sweep(data->ref_bits, ft->size, data->clock_hand);
+                add_victim(data, victim);
+                page_map_del(&data->page_index, ft->page[victim]);
+                clock_load(data, victim, page_ref);
+                data->clock_hand = (victim + 1) % ft->size;
+                fault = 1;
+        }
+
+        return fault;
+}
+
+/*
+ * CLOCK-Pro state. Resident (hot and cold) pages and non-resident cold
+ * pages still in their test period share one circular list, nodes are
+ * array indices. page_index maps a page to its node and ref_bits holds
+ * one reference bit per node.
+ */
+enum { CP_HOT, CP_COLD, CP_TEST };
+
+typedef struct Clock_Pro
+{
+	int *page; // page per node
+	int *frame; // frame holding the node's page, -1 for test pages
+	int *next, *prev; // circular list
+	unsigned char *type; // CP_HOT, CP_COLD or CP_TEST
+	int *free_nodes, nfree_nodes;
+	int *free_frames, nfree_frames;
+	int hand_hot, hand_cold, hand_test; // -1 while the list is empty
+	int mem_max; // number of frames
+	int mem_cold; // adaptive target for cold pages
+	int count_hot, count_cold, count_test;
+	int hot_running; // hot hand is moving, see clock_pro_run_hand_cold()
+} Clock_Pro;
+
+static size_t clock_pro_bytes(int mem_max)
+{
+	int nodes = 2 * mem_max + 1; // resident <= mem_max, test <= mem_max
+	return sizeof(Clock_Pro) + ((size_t)nodes * 5 + mem_max) * sizeof(int) + nodes;
+}
+
+/* point the arrays into the allocation after the struct */
+static void clock_pro_layout(Clock_Pro *cp, int mem_max)
+{
+	int nodes = 2 * mem_max + 1;
+	int *p = (int *)(cp + 1);
+	cp->page = p; p += nodes;
+	cp->frame = p; p += nodes;
+	cp->next = p; p += nodes;
+	cp->prev = p; p += nodes;
+	cp->free_nodes = p; p += nodes;
+	cp->free_frames = p; p += mem_max;
+	cp->type = (unsigned char *)p;
+}
+
+static Clock_Pro *clock_pro_create(int mem_max)
+{
+	int nodes = 2 * mem_max + 1;
+	Clock_Pro *cp = malloc(clock_pro_bytes(mem_max));
+	int i = 0;
+	clock_pro_layout(cp, mem_max);
+	for(i = 0; i < nodes; i++)
+		cp->free_nodes[i] = nodes - 1 - i;
+	cp->nfree_nodes = nodes;
+	for(i = 0; i < mem_max; i++)
+		cp->free_frames[i] = mem_max - 1 - i; // hand out frame 0 first
+	cp->nfree_frames = mem_max;
+	cp->hand_hot = cp->hand_cold = cp->hand_test = -1;
+	cp->mem_max = mem_max;
+	cp->mem_cold = mem_max;
+	cp->count_hot = cp->count_cold = cp->count_test = 0;
+	cp->hot_running = 0;
+	return cp;
+}
+
+static void clock_pro_init(Algorithm_Data *data)
+{
+	data->policy_state = clock_pro_create(data->page_table.size);
+}
+
+static size_t clock_pro_state_size(const Algorithm_Data *data)
+{
+	return clock_pro_bytes(data->page_table.size);
+}
+
+static void clock_pro_relink(Algorithm_Data *data)
+{
+	clock_pro_layout(data->policy_state, data->page_table.size);
+}
+
+static void clock_pro_run_hand_cold(Algorithm_Data *data, Clock_Pro *cp);
+
+/* insert node n just behind the hot hand, the head of the clock */
+static void clock_pro_meta_add(Algorithm_Data *data, Clock_Pro *cp, int n);
+
+static void clock_pro_meta_del(Algorithm_Data *data, Clock_Pro *cp, int n)
+{
+	if(cp->next[n] == n)
+		cp->hand_hot = cp->hand_cold = cp->hand_test = -1;
+	else
+	{
+		if(n == cp->hand_hot) cp->hand_hot = cp->prev[n];
+		if(n == cp->hand_cold) cp->hand_cold = cp->prev[n];
+		if(n == cp->hand_test) cp->hand_test = cp->prev[n];
+		cp->next[cp->prev[n]] = cp->next[n];
+		cp->prev[cp->next[n]] = cp->prev[n];
+	}
+	page_map_del(&data->page_index, cp->page[n]);
+}
+
+/* the test hand retires non-resident pages whose test period is over */
+static void clock_pro_run_hand_test(Algorithm_Data *data, Clock_Pro *cp)
+{
+	int n = -1;
+	if(cp->hand_test == cp->hand_cold)
+		clock_pro_run_hand_cold(data, cp);
+	if((n = cp->hand_test) == -1)
+		return;
+	if(cp->type[n] == CP_TEST)
+	{
+		int prev = cp->prev[n];
+		clock_pro_meta_del(data, cp, n);
+		cp->free_nodes[cp->nfree_nodes++] = n;
+		cp->count_test--;
+		if(cp->mem_cold > 1) // a test page expired unused, cold pages need less room
+			cp->mem_cold--;
+		if(cp->hand_test == -1)
+			return;
+		cp->hand_test = prev;
+	}
+	cp->hand_test = cp->next[cp->hand_test];
+}
+
+/* the hot hand demotes hot pages that were not referenced in a full turn */
+static void clock_pro_run_hand_hot(Algorithm_Data *data, Clock_Pro *cp)
+{
+	int n = -1;
+	cp->hot_running = 1;
+	if(cp->hand_hot == cp->hand_test)
+		clock_pro_run_hand_test(data, cp);
+	cp->hot_running = 0;
+	if((n = cp->hand_hot) == -1)
+		return;
+	if(cp->type[n] == CP_HOT)
+	{
+		if(bitmap_test(data->ref_bits, n))
+			bitmap_clear(data->ref_bits, n);
+		else
+		{
+			cp->type[n] = CP_COLD;
+			cp->count_hot--;
+			cp->count_cold++;
+		}
+	}
+	cp->hand_hot = cp->next[cp->hand_hot];
+}
+
+/*
+ * the cold hand promotes referenced cold pages and evicts the others,
+ * which stay on the clock as test pages
+ */
+static void clock_pro_run_hand_cold(Algorithm_Data *data, Clock_Pro *cp)
+{
+	Frame_Table *ft = &data->page_table;
+	int n = cp->hand_cold;
+	if(n == -1)
+		return;
+	if(cp->type[n] == CP_COLD)
+	{
+		if(bitmap_test(data->ref_bits, n))
+		{
+			cp->type[n] = CP_HOT;
+			bitmap_clear(data->ref_bits, n);
+			cp->count_cold--;
+			cp->count_hot++;
+		}
+		else
+		{
+			add_victim(data, cp->frame[n]);
+			ft->page[cp->frame[n]] = -1;
+			cp->free_frames[cp->nfree_frames++] = cp->frame[n];
+			cp->frame[n] = -1;
+			cp->type[n] = CP_TEST;
+			cp->count_cold--;
+			cp->count_test++;
+			while(cp->mem_max < cp->count_test)
+				clock_pro_run_hand_test(data, cp);
+		}
+	}
+	if(cp->hand_cold != -1)
+		cp->hand_cold = cp->next[cp->hand_cold];
+	// when the hot hand pushed us here through the test hand it is about to
+	// move anyway, running it again would chase the same three hands forever
+	while(!cp->hot_running && cp->mem_max - cp->mem_cold < cp->count_hot)
+		clock_pro_run_hand_hot(data, cp);
+}
+
+static void clock_pro_meta_add(Algorithm_Data *data, Clock_Pro *cp, int n)
+{
+	// make room for one more resident page first
+	while(cp->mem_max <= cp->count_hot + cp->count_cold)
+		clock_pro_run_hand_cold(data, cp);
+	if(cp->hand_hot == -1)
+	{
+		cp->next[n] = cp->prev[n] = n;
+		cp->hand_hot = cp->hand_cold = cp->hand_test = n;
+	}
+	else
+	{
+		cp->prev[n] = cp->prev[cp->hand_hot];
+		cp->next[n] = cp->hand_hot;
+		cp->next[cp->prev[n]] = n;
+		cp->prev[cp->hand_hot] = n;
+	}
+	if(cp->hand_cold == cp->hand_hot)
+		cp->hand_cold = cp->prev[cp->hand_cold];
+	page_map_put(&data->page_index, cp->page[n], n);
+}
+
+/**
+ * int CLOCK_PRO(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * CLOCK-Pro Page Replacement Algorithm (Jiang, Chen & Zhang, USENIX ATC 2005)
+ *
+ * Pages are hot or cold by reuse distance. New pages start cold; a cold
+ * page referenced again before the cold hand reaches it turns hot, an
+ * unreferenced one is evicted but kept as a non-resident test page. A
+ * miss on a test page admits it straight as hot and grows the cold
+ * target, an expired test page shrinks it.
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int CLOCK_PRO(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        Clock_Pro *cp = data->policy_state;
+        int node = -1;
+        int fault = 0;
+
+
+        node = page_map_get(&data->page_index, page_ref);
+        if(node != -1 && cp->type[node] != CP_TEST)
+        { // The page was found! Hit!
+                bitmap_set(data->ref_bits, node);
+                ft->tick[cp->frame[node]] = data->total_ref_count;
+        }
+        else
+        {
+                if(node == -1)
+                { // never seen or test period over, admit as cold
+                        node = cp->free_nodes[--cp->nfree_nodes];
+                        cp->page[node] = page_ref;
+                        cp->type[node] = CP_COLD;
+                        bitmap_clear(data->ref_bits, node);
+                        clock_pro_meta_add(data, cp, node);
+                        cp->count_cold++;
+                }
+                else
+                { // reuse distance shorter than the cold pages', admit as hot
+                        if(cp->mem_cold < cp->mem_max)
+                                cp->mem_cold++;
+                        bitmap_clear(data->ref_bits, node);
+                        cp->type[node] = CP_HOT;
+                        cp->count_test--;
+                        clock_pro_meta_del(data, cp, node);
+                        clock_pro_meta_add(data, cp, node);
+                        cp->count_hot++;
+                }
+                cp->frame[node] = cp->free_frames[--cp->nfree_frames];
+                ft->page[cp->frame[node]] = page_ref;
+                ft->tick[cp->frame[node]] = data->total_ref_count;
+                ft->extra[cp->frame[node]] = cp->type[node];
+                fault = 1;
+        }
+
+        return fault;
+}
+
+REGISTER_POLICY(clock, CLOCK, .label = "CLOCK", .order = 4)
+REGISTER_POLICY(second_chance, SECOND_CHANCE, .label = "SECOND_CHANCE", .order = 11)
+REGISTER_POLICY(clock_pro, CLOCK_PRO, .label = "CLOCK_PRO", .order = 12,
+		.init = clock_pro_init, .state_size = clock_pro_state_size, .relink = clock_pro_relink)
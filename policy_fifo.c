@@ -0,0 +1,283 @@
+/*
+   Page Replacement Algorithms: FIFO family
+   Description: S3-FIFO and SIEVE, FIFO queues whose hit path is a single
+   store.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bitmap.h"
+#include "node_list.h"
+#include "ring.h"
+#include "policy.h"
+
+/*
+ * S3-FIFO state (Yang et al., SOSP 2023). The small queue takes new pages,
+ * the main queue pages seen again while in small or recently in the ghost
+ * queue. Resident queues hold frame numbers, the per frame 2 bit hit
+ * counter lives in the extra field. The ghost queue holds page numbers of
+ * pages evicted from small; page_index maps them to frames + their ghost
+ * slot so they are told apart from resident pages.
+ */
+typedef struct S3_Fifo
+{
+	Ring small, main, ghost;
+	int small_max; // 10% of frames
+} S3_Fifo;
+
+static int s3_fifo_ghost_max(int frames)
+{
+	int small_max = frames / 10 > 0 ? frames / 10 : 1;
+	return frames - small_max > 0 ? frames - small_max : 1;
+}
+
+static size_t s3_fifo_bytes(int frames)
+{
+	return sizeof(S3_Fifo) + sizeof(int) * (size_t)(2 * frames + s3_fifo_ghost_max(frames));
+}
+
+static S3_Fifo *s3_fifo_create(int frames)
+{
+	S3_Fifo *s = malloc(s3_fifo_bytes(frames));
+	int *p = (int *)(s + 1);
+	ring_init(&s->small, p, frames);
+	ring_init(&s->main, p + frames, frames);
+	ring_init(&s->ghost, p + 2 * frames, s3_fifo_ghost_max(frames));
+	s->small_max = frames / 10 > 0 ? frames / 10 : 1;
+	return s;
+}
+
+static void s3_fifo_init(Algorithm_Data *data)
+{
+	data->policy_state = s3_fifo_create(data->page_table.size);
+}
+
+static size_t s3_fifo_state_size(const Algorithm_Data *data)
+{
+	return s3_fifo_bytes(data->page_table.size);
+}
+
+/* point the rings back into the allocation after a copy */
+static void s3_fifo_relink(Algorithm_Data *data)
+{
+	S3_Fifo *s = data->policy_state;
+	int *p = (int *)(s + 1);
+	int frames = data->page_table.size;
+	s->small.buf = p;
+	s->main.buf = p + frames;
+	s->ghost.buf = p + 2 * frames;
+}
+
+static void s3_fifo_remember(Algorithm_Data *data, S3_Fifo *s, int page)
+{
+	int frames = data->page_table.size;
+	if(s->ghost.len == s->ghost.cap)
+	{ // forget the oldest ghost unless the page came back since
+		int slot = s->ghost.head;
+		int old = ring_pop(&s->ghost);
+		if(page_map_get(&data->page_index, old) == frames + slot)
+			page_map_del(&data->page_index, old);
+	}
+	page_map_put(&data->page_index, page, frames + ring_push(&s->ghost, page));
+}
+
+/*
+ * free a frame: pages leaving small that were hit more than once move to
+ * main, the others are evicted and remembered as ghosts. Main is a FIFO
+ * with reinsertion, a page with hits left is pushed back with one less.
+ */
+static int s3_fifo_evict(Algorithm_Data *data, S3_Fifo *s)
+{
+	Frame_Table *ft = &data->page_table;
+	int victim = -1;
+	if(s->small.len >= s->small_max || s->main.len == 0)
+		while(victim == -1 && s->small.len > 0)
+		{
+			int t = ring_pop(&s->small);
+			if(ft->extra[t] > 1)
+			{
+				ft->extra[t] = 0;
+				ring_push(&s->main, t);
+			}
+			else
+			{
+				victim = t;
+				page_map_del(&data->page_index, ft->page[t]);
+				s3_fifo_remember(data, s, ft->page[t]);
+			}
+		}
+	while(victim == -1)
+	{
+		int t = ring_pop(&s->main);
+		if(ft->extra[t] > 0)
+		{
+			ft->extra[t]--;
+			ring_push(&s->main, t);
+		}
+		else
+		{
+			victim = t;
+			page_map_del(&data->page_index, ft->page[t]);
+		}
+	}
+	add_victim(data, victim);
+	return victim;
+}
+
+/**
+ * int S3_FIFO(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * S3-FIFO Page Replacement Algorithm
+ *
+ * Three FIFO queues: one-hit wonders are filtered out by the small queue
+ * before they can disturb main. A hit only bumps a saturating counter, no
+ * queue is touched.
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int S3_FIFO(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        S3_Fifo *s = data->policy_state;
+        int framep = -1;
+        int ghost = 0;
+        int fault = 0;
+
+
+        framep = page_map_get(&data->page_index, page_ref);
+        if(framep != -1 && framep < ft->size)
+        { // The page was found! Hit!
+                if(ft->extra[framep] < 3)
+                        ft->extra[framep]++;
+        }
+        else
+        {
+                ghost = framep != -1;
+                if(ghost)
+                        page_map_del(&data->page_index, page_ref);
+                if(ft->used < ft->size)
+                        framep = ft->used++;
+                else
+                        framep = s3_fifo_evict(data, s);
+                ring_push(ghost ? &s->main : &s->small, framep);
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = 0;
+                page_map_put(&data->page_index, page_ref, framep);
+                fault = 1;
+        }
+
+        return fault;
+}
+
+/*
+ * SIEVE state (Zhang et al., NSDI 2024). Frames are queued newest first
+ * through index links, visited bits are in ref_bits. Survivors are not
+ * moved, so a victim can come from the middle of the queue and a ring
+ * would have to shift; the links make that O(1).
+ */
+typedef struct Sieve
+{
+	int *next, *prev;
+	Node_List queue;
+	int hand; // next frame to look at, -1 starts over from the oldest
+} Sieve;
+
+static size_t sieve_bytes(int frames)
+{
+	return sizeof(Sieve) + sizeof(int) * (size_t)(2 * frames);
+}
+
+static void sieve_layout(Sieve *sv, int frames)
+{
+	sv->next = (int *)(sv + 1);
+	sv->prev = sv->next + frames;
+}
+
+static Sieve *sieve_create(int frames)
+{
+	Sieve *sv = malloc(sieve_bytes(frames));
+	sieve_layout(sv, frames);
+	node_list_init(&sv->queue);
+	sv->hand = -1;
+	return sv;
+}
+
+static void sieve_init(Algorithm_Data *data)
+{
+	data->policy_state = sieve_create(data->page_table.size);
+}
+
+static size_t sieve_state_size(const Algorithm_Data *data)
+{
+	return sieve_bytes(data->page_table.size);
+}
+
+static void sieve_relink(Algorithm_Data *data)
+{
+	sieve_layout(data->policy_state, data->page_table.size);
+}
+
+/**
+ * int SIEVE(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * SIEVE Page Replacement Algorithm
+ *
+ * Like CLOCK the hand clears visited bits until it finds an unvisited
+ * frame, but new pages join the head of the queue instead of taking the
+ * victim's place, so new pages that are never hit again leave quickly.
+ * A hit only sets the visited bit.
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int SIEVE(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        Sieve *sv = data->policy_state;
+        int framep = -1;
+        int fault = 0;
+
+
+        framep = page_map_get(&data->page_index, page_ref);
+        if(framep != -1)
+        { // The page was found! Hit!
+                bitmap_set(data->ref_bits, framep);
+        }
+        else
+        {
+                if(ft->used < ft->size)
+                        framep = ft->used++;
+                else
+                { // move the hand from old to new until an unvisited frame
+                        framep = sv->hand != -1 ? sv->hand : sv->queue.tail;
+                        while(bitmap_test(data->ref_bits, framep))
+                        {
+                                bitmap_clear(data->ref_bits, framep);
+                                framep = sv->prev[framep] != -1 ? sv->prev[framep] : sv->queue.tail;
+                        }
+                        sv->hand = sv->prev[framep];
+                        node_list_remove(&sv->queue, sv->next, sv->prev, framep);
+                        add_victim(data, framep);
+                        page_map_del(&data->page_index, ft->page[framep]);
+                }
+                node_list_push_head(&sv->queue, sv->next, sv->prev, framep);
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                page_map_put(&data->page_index, page_ref, framep);
+                fault = 1;
+        }
+
+        return fault;
+}
+
+REGISTER_POLICY(s3_fifo, S3_FIFO, .label = "S3_FIFO", .alias = "S3FIFO", .order = 15,
+		.init = s3_fifo_init, .state_size = s3_fifo_state_size, .relink = s3_fifo_relink)
+REGISTER_POLICY(sieve, SIEVE, .label = "SIEVE", .order = 16,
+		.init = sieve_init, .state_size = sieve_state_size, .relink = sieve_relink)
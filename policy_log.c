@@ -0,0 +1,497 @@
+/*
+   Page Replacement Algorithms: reference log policies
+   Description: LOG, LOG_NOWIN (lowest reference rate) and LRU-K (LRU2,
+   LRU3), driven by exact per page reference logs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/queue.h>
+#include "policy.h"
+
+// one entry of a reference log
+typedef struct Page_Log
+{
+        TAILQ_ENTRY(Page_Log) pages; // frames node, next
+        int page_num;
+		size_t ref_count;
+} Page_Log;
+
+TAILQ_HEAD(Page_Log_List, Page_Log);
+
+/*
+ * LOG and LRU-K state: per page reference counts, and the window log of
+ * the most recent references (page_num only), oldest first
+ */
+typedef struct Log_State
+{
+		struct Page_Log_List ref_log; // for reference rate calculation
+		struct Page_Log_List window_log; // for log window history
+		size_t window_log_size;
+} Log_State;
+
+static void log_init(Algorithm_Data *data)
+{
+		Log_State *lg = malloc(sizeof(Log_State));
+		TAILQ_INIT(&lg->ref_log);
+		TAILQ_INIT(&lg->window_log);
+		lg->window_log_size = 0;
+		data->policy_state = lg;
+}
+
+static void log_destroy(Algorithm_Data *data)
+{
+		Log_State *lg = data->policy_state;
+		Page_Log *pg = NULL;
+		while ((pg = lg->ref_log.tqh_first) != NULL)
+		{
+				TAILQ_REMOVE(&lg->ref_log, pg, pages);
+				free(pg);
+		}
+		while ((pg = lg->window_log.tqh_first) != NULL)
+		{
+				TAILQ_REMOVE(&lg->window_log, pg, pages);
+				free(pg);
+		}
+		free(lg);
+}
+
+/*
+ * Checkpoint image of a Log_State: the list lengths, then the ref_log
+ * counts and pages, then the window_log pages, each oldest first
+ */
+typedef struct Log_Image
+{
+		uint64_t nref, nwindow, window_log_size;
+} Log_Image;
+
+static size_t log_state_size(const Algorithm_Data *data)
+{
+		const Log_State *lg = data->policy_state;
+		const Page_Log *pg = NULL;
+		size_t nref = 0, nwindow = 0;
+		TAILQ_FOREACH(pg, &lg->ref_log, pages)
+				nref++;
+		TAILQ_FOREACH(pg, &lg->window_log, pages)
+				nwindow++;
+		return sizeof(Log_Image) + nref * (sizeof(uint64_t) + sizeof(int)) + nwindow * sizeof(int);
+}
+
+static void log_state_save(const Algorithm_Data *data, void *image)
+{
+		const Log_State *lg = data->policy_state;
+		const Page_Log *pg = NULL;
+		Log_Image *hdr = image;
+		uint64_t *counts = (uint64_t *)(hdr + 1);
+		int *pages = NULL;
+		size_t i = 0;
+		hdr->nref = hdr->nwindow = 0;
+		TAILQ_FOREACH(pg, &lg->ref_log, pages)
+				counts[hdr->nref++] = pg->ref_count;
+		pages = (int *)(counts + hdr->nref);
+		TAILQ_FOREACH(pg, &lg->ref_log, pages)
+				pages[i++] = pg->page_num;
+		TAILQ_FOREACH(pg, &lg->window_log, pages)
+				pages[i + hdr->nwindow++] = pg->page_num;
+		hdr->window_log_size = lg->window_log_size;
+}
+
+static void log_state_load(Algorithm_Data *data, const void *image)
+{
+		const Log_Image *hdr = image;
+		const uint64_t *counts = (const uint64_t *)(hdr + 1);
+		const int *pages = (const int *)(counts + hdr->nref);
+		Log_State *lg = NULL;
+		Page_Log *pg = NULL;
+		uint64_t i = 0;
+		log_init(data);
+		lg = data->policy_state;
+		for(i = 0; i < hdr->nref; i++)
+		{
+				pg = malloc(sizeof(struct Page_Log));
+				pg->page_num = pages[i];
+				pg->ref_count = counts[i];
+				TAILQ_INSERT_TAIL(&lg->ref_log, pg, pages);
+		}
+		for(i = 0; i < hdr->nwindow; i++)
+		{
+				pg = malloc(sizeof(struct Page_Log));
+				pg->page_num = pages[hdr->nref + i];
+				pg->ref_count = 0;
+				TAILQ_INSERT_TAIL(&lg->window_log, pg, pages);
+		}
+		lg->window_log_size = hdr->window_log_size;
+}
+
+/*
+ * pick the resident page with the lowest hotness (ref_count / total refs)
+ * from the page reference log
+ */
+static int log_min_hotness(Algorithm_Data *data)
+{
+        Frame_Table *ft = &data->page_table;
+        Log_State *lg = data->policy_state;
+		struct Page_Log *pg = NULL;
+		double hotness = 0.0;
+		double min_hotness=1.0;
+		int victim = -1;
+		int i = 0;
+		for(i = 0; i < ft->size; i++)
+		{
+			TAILQ_FOREACH(pg, &lg->ref_log, pages)
+			{
+				if(ft->page[i] == pg->page_num)
+				{
+					hotness = (double)pg->ref_count/(double)data->total_ref_count;
+					if(hotness < min_hotness)
+					{
+						min_hotness = hotness;
+						victim = i;
+					}
+				}
+			}
+		}
+		return victim;
+}
+
+static int LOG_NOWIN(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        Log_State *lg = data->policy_state;
+        int framep = -1,
+            victim = -1;
+
+		struct Page_Log *page = NULL;
+        int fault = 0;
+
+
+		/* increase page reference count by 1 */
+		int counted=0;
+		struct Page_Log *pg = NULL;
+		TAILQ_FOREACH(pg, &lg->ref_log, pages)
+		{
+			if(pg->page_num == page_ref)
+			{
+				pg->ref_count++;
+				counted = 1;
+				break;
+			}
+		}
+
+		if(counted ==0) // if this page is never referenced before, add to log
+		{
+			page = malloc(sizeof(struct Page_Log));
+			page->page_num = page_ref;
+			page->ref_count = 1;
+			TAILQ_INSERT_TAIL(&lg->ref_log, page, pages);
+		}
+
+		framep = frame_table_find(ft, page_ref);
+
+        /* Make a decision */
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+			/*
+			 * search log list for ref_count of page num contained by frame list.
+			 * pick the one with lowest hotness to evict.
+			 */
+			victim = log_min_hotness(data);
+
+			add_victim(data, victim);
+
+			ft->page[victim] = page_ref;
+			ft->tick[victim] = data->total_ref_count;
+			ft->extra[victim] = data->total_ref_count - 1;
+			fault = 1;
+        }
+        else if(framep == -1)
+        { // Can use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+        }
+
+
+        return fault;
+}
+
+static int LOG(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        Log_State *lg = data->policy_state;
+        int framep = -1,
+            victim = -1;
+
+		struct Page_Log *page = NULL;
+        int fault = 0;
+
+
+		/* increase page reference count by 1 */
+		int counted=0;
+		struct Page_Log *pg = NULL;
+		TAILQ_FOREACH(pg, &lg->ref_log, pages)
+		{
+			if(pg->page_num == page_ref)
+			{
+				pg->ref_count++;
+				counted = 1;
+				break;
+			}
+		}
+
+		if(counted ==0) // if this page is never referenced before, add to log
+		{
+			page = malloc(sizeof(struct Page_Log));
+			page->page_num = page_ref;
+			page->ref_count = 1;
+			TAILQ_INSERT_TAIL(&lg->ref_log, page, pages);
+		}
+
+		page = malloc(sizeof(struct Page_Log));
+		page->page_num = page_ref;
+		// insert to window log here
+		TAILQ_INSERT_TAIL(&lg->window_log, page, pages);
+		lg->window_log_size++;
+
+		if(_window_size > 0 && lg->window_log_size > _window_size)
+		{
+			page = lg->window_log.tqh_first;
+			TAILQ_FOREACH(pg, &lg->ref_log, pages)
+			{
+				if(pg->page_num == page->page_num)
+				{
+					pg->ref_count--;
+					break;
+				}
+			}
+			if(page != NULL) // just in case
+			{
+				TAILQ_REMOVE(&lg->window_log, page, pages);
+				free(page);
+				lg->window_log_size--;
+			}
+		}
+
+		framep = frame_table_find(ft, page_ref);
+
+        /* Make a decision */
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+			/*
+			 * until the window is filled evict the least recently used
+			 * frame, then pick the one with lowest hotness from the log.
+			 */
+			if( _window_size > 0 && lg->window_log_size < _window_size)
+				victim = argmin_tick(ft->tick, ft->size);
+			else
+				victim = log_min_hotness(data);
+
+			add_victim(data, victim);
+
+			ft->page[victim] = page_ref;
+			ft->tick[victim] = data->total_ref_count;
+			ft->extra[victim] = data->total_ref_count - 1;
+			fault = 1;
+        }
+        else if(framep == -1)
+        { // Can use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+        }
+
+
+        return fault;
+}
+
+/*
+ * LRU-K victim search: the resident page whose k-th most recent reference
+ * in the window log is furthest back. Returns -1 when some page has fewer
+ * than k references logged, callers fall back to LRU then.
+ * require_two keeps LRU3's habit of ignoring pages seen only once.
+ */
+static int lru_k_victim(Algorithm_Data *data, int k_value, int require_two)
+{
+        Frame_Table *ft = &data->page_table;
+        Log_State *lg = data->policy_state;
+		struct Page_Log *pg = NULL;
+		int victim = -1;
+		int max_distance = 0;
+		int tmp_d=0;
+		int tmp_dk=0;
+		int tmp_k=1;
+		int use_lru=0;
+		int i = 0;
+
+        for (i = 0; i < ft->size; i++)
+		{
+			tmp_d = 0;
+			tmp_dk= 0;
+			tmp_k = 0;
+			// run through log and find k-th furthest page
+			TAILQ_FOREACH_REVERSE(pg, &lg->window_log, Page_Log_List, pages)
+			{
+				tmp_d++;
+				if(ft->page[i] == pg->page_num)
+				{
+					tmp_k++;
+					tmp_dk=tmp_d;
+				}
+
+				if(tmp_k==k_value)
+				{
+					use_lru=0;
+					break;
+				}
+				else
+					use_lru=1;
+			}
+
+			if(use_lru)
+				return -1;
+
+			if((!require_two || tmp_k > 1) && max_distance < tmp_dk)
+			{
+				max_distance = tmp_dk;
+				victim = i;
+			}
+        }
+		return victim;
+}
+
+static int LRU2(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        Log_State *lg = data->policy_state;
+        int framep = -1,
+            victim = -1;
+
+        int fault = 0;
+		int k_value = 2;
+		struct Page_Log* page=NULL;
+
+
+			/*
+			 * add to log
+			 */
+		page = malloc(sizeof(struct Page_Log));
+		page->page_num = page_ref;
+		TAILQ_INSERT_TAIL(&lg->window_log, page, pages);
+
+		/*
+		 *  search page table for the frame holding referenced page.
+		 */
+        framep = frame_table_find(ft, page_ref);
+
+        /* Make a decision */
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+			victim = lru_k_victim(data, k_value, 0);
+			// if victim is not found, use LRU
+			if(victim == -1)
+				victim = argmin_tick(ft->tick, ft->size);
+
+			add_victim(data, victim);
+
+			ft->page[victim] = page_ref;
+			ft->tick[victim] = data->total_ref_count;
+			ft->extra[victim] = data->total_ref_count - 1;
+			fault = 1;
+        }
+        else if(framep == -1)
+        { // Can use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+        }
+
+        return fault;
+}
+
+static int LRU3(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        Log_State *lg = data->policy_state;
+        int framep = -1,
+            victim = -1;
+
+        int fault = 0;
+		int k_value = 3;
+		struct Page_Log* page=NULL;
+
+			/*
+			 * add to log
+			 */
+		page = malloc(sizeof(struct Page_Log));
+		page->page_num = page_ref;
+		TAILQ_INSERT_TAIL(&lg->window_log, page, pages);
+
+		/*
+		 *  search page table for the frame holding referenced page.
+		 */
+        framep = frame_table_find(ft, page_ref);
+
+        /* Make a decision */
+        if(framep == -1 && ft->used == ft->size)
+        { // It's a miss, kill our victim
+			victim = lru_k_victim(data, k_value, 1);
+			// if victim is not found, use LRU
+			if(victim == -1)
+				victim = argmin_tick(ft->tick, ft->size);
+
+			add_victim(data, victim);
+
+			ft->page[victim] = page_ref;
+			ft->tick[victim] = data->total_ref_count;
+			ft->extra[victim] = data->total_ref_count - 1;
+			fault = 1;
+        }
+        else if(framep == -1)
+        { // Can use free page table index
+                framep = ft->used++;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+                fault = 1;
+        }
+        else
+        { // The page was found! Hit!
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = data->total_ref_count - 1;
+        }
+
+        return fault;
+}
+
+REGISTER_POLICY(log, LOG, .label = "LOG", .order = 7,
+		.init = log_init, .destroy = log_destroy,
+		.state_size = log_state_size, .state_save = log_state_save, .state_load = log_state_load)
+REGISTER_POLICY(log_nowin, LOG_NOWIN, .label = "LOG_NOWIN", .order = 8, .flags = POLICY_FULL_TRACE,
+		.init = log_init, .destroy = log_destroy,
+		.state_size = log_state_size, .state_save = log_state_save, .state_load = log_state_load)
+REGISTER_POLICY(lru2, LRU2, .label = "LRU2", .order = 9,
+		.init = log_init, .destroy = log_destroy,
+		.state_size = log_state_size, .state_save = log_state_save, .state_load = log_state_load)
+REGISTER_POLICY(lru3, LRU3, .label = "LRU3", .order = 10,
+		.init = log_init, .destroy = log_destroy,
+		.state_size = log_state_size, .state_save = log_state_save, .state_load = log_state_load)
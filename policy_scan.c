@@ -0,0 +1,431 @@
+/*
+   Page Replacement Algorithms: scan resistant policies
+   Description: 2Q and LIRS, entries live in flat arrays linked through
+   index lists (node_list.h).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "node_list.h"
+#include "policy.h"
+
+/*
+ * 2Q state (Johnson & Shasha, VLDB 1994, "full" version). Resident pages
+ * seen once sit on the A1in FIFO, pages re-referenced after falling off
+ * A1in go to the Am LRU, and A1out remembers the page numbers recently
+ * paged out of A1in. Nodes are array indices, page_index maps a page to
+ * its node.
+ */
+enum { TWO_Q_A1IN, TWO_Q_A1OUT, TWO_Q_AM };
+
+typedef struct Two_Q
+{
+	int *page, *frame; // frame is -1 for A1out entries
+	int *next, *prev;
+	unsigned char *where; // TWO_Q_A1IN, TWO_Q_A1OUT or TWO_Q_AM
+	int *free_nodes, nfree_nodes;
+	Node_List a1in, a1out, am;
+	int kin; // A1in size, 25% of frames
+	int kout; // A1out size, 50% of frames
+} Two_Q;
+
+static int two_q_nodes(int frames)
+{
+	int kout = frames / 2 > 0 ? frames / 2 : 1;
+	return frames + kout + 1;
+}
+
+static size_t two_q_bytes(int frames)
+{
+	return sizeof(Two_Q) + (size_t)two_q_nodes(frames) * (5 * sizeof(int) + 1);
+}
+
+/* point the arrays into the allocation after the struct */
+static void two_q_layout(Two_Q *q, int frames)
+{
+	int nodes = two_q_nodes(frames);
+	int *p = (int *)(q + 1);
+	q->page = p; p += nodes;
+	q->frame = p; p += nodes;
+	q->next = p; p += nodes;
+	q->prev = p; p += nodes;
+	q->free_nodes = p; p += nodes;
+	q->where = (unsigned char *)p;
+}
+
+static Two_Q *two_q_create(int frames)
+{
+	int kout = frames / 2 > 0 ? frames / 2 : 1;
+	int nodes = two_q_nodes(frames);
+	Two_Q *q = malloc(two_q_bytes(frames));
+	int i = 0;
+	two_q_layout(q, frames);
+	for(i = 0; i < nodes; i++)
+		q->free_nodes[i] = nodes - 1 - i;
+	q->nfree_nodes = nodes;
+	node_list_init(&q->a1in);
+	node_list_init(&q->a1out);
+	node_list_init(&q->am);
+	q->kin = frames / 4 > 0 ? frames / 4 : 1;
+	q->kout = kout;
+	return q;
+}
+
+static void two_q_init(Algorithm_Data *data)
+{
+	data->policy_state = two_q_create(data->page_table.size);
+}
+
+static size_t two_q_state_size(const Algorithm_Data *data)
+{
+	return two_q_bytes(data->page_table.size);
+}
+
+static void two_q_relink(Algorithm_Data *data)
+{
+	two_q_layout(data->policy_state, data->page_table.size);
+}
+
+/*
+ * free a frame for the page being loaded: page out the A1in tail (and
+ * remember it on A1out) while A1in is over its share, else the Am tail
+ */
+static int two_q_reclaim(Algorithm_Data *data, Two_Q *q)
+{
+	Frame_Table *ft = &data->page_table;
+	int n = -1, frame = -1;
+	if(ft->used < ft->size)
+		return ft->used++;
+	if(q->a1in.len > q->kin || q->am.len == 0)
+	{
+		n = node_list_pop_tail(&q->a1in, q->next, q->prev);
+		frame = q->frame[n];
+		q->frame[n] = -1;
+		q->where[n] = TWO_Q_A1OUT;
+		node_list_push_head(&q->a1out, q->next, q->prev, n);
+		if(q->a1out.len > q->kout)
+		{
+			n = node_list_pop_tail(&q->a1out, q->next, q->prev);
+			page_map_del(&data->page_index, q->page[n]);
+			q->free_nodes[q->nfree_nodes++] = n;
+		}
+	}
+	else
+	{
+		n = node_list_pop_tail(&q->am, q->next, q->prev);
+		frame = q->frame[n];
+		page_map_del(&data->page_index, q->page[n]);
+		q->free_nodes[q->nfree_nodes++] = n;
+	}
+	add_victim(data, frame);
+	return frame;
+}
+
+/**
+ * int TWO_Q(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * 2Q Page Replacement Algorithm
+ *
+ * A page has to be referenced again after it left the A1in FIFO to make
+ * it onto the Am LRU, so a sequential scan only churns A1in.
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int TWO_Q(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        Two_Q *q = data->policy_state;
+        int node = -1,
+            framep = -1;
+        int fault = 0;
+
+
+        node = page_map_get(&data->page_index, page_ref);
+        if(node != -1 && q->where[node] != TWO_Q_A1OUT)
+        { // The page was found! Hit! Only Am keeps recency
+                if(q->where[node] == TWO_Q_AM)
+                        node_list_move_head(&q->am, q->next, q->prev, node);
+                ft->tick[q->frame[node]] = data->total_ref_count;
+        }
+        else
+        {
+                framep = two_q_reclaim(data, q);
+                // look again, reclaiming may have dropped the A1out entry
+                node = page_map_get(&data->page_index, page_ref);
+                if(node != -1)
+                { // remembered on A1out, it is hot
+                        node_list_remove(&q->a1out, q->next, q->prev, node);
+                        q->where[node] = TWO_Q_AM;
+                        node_list_push_head(&q->am, q->next, q->prev, node);
+                }
+                else
+                {
+                        node = q->free_nodes[--q->nfree_nodes];
+                        q->page[node] = page_ref;
+                        q->where[node] = TWO_Q_A1IN;
+                        node_list_push_head(&q->a1in, q->next, q->prev, node);
+                        page_map_put(&data->page_index, page_ref, node);
+                }
+                q->frame[node] = framep;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = q->where[node];
+                fault = 1;
+        }
+
+        return fault;
+}
+
+/*
+ * LIRS state (Jiang & Zhang, SIGMETRICS 2002). Stack S orders LIR pages,
+ * resident HIR pages and non-resident HIR pages by recency and always has
+ * a LIR page at the bottom. Queue Q holds the resident HIR pages, the
+ * eviction candidates. Non-resident HIR pages are also kept on a ghost
+ * FIFO (through the Q links, they are never on Q) so S stays bounded.
+ */
+enum { LIRS_LIR, LIRS_HIR, LIRS_NONRES };
+
+typedef struct Lirs
+{
+	int *page, *frame; // frame is -1 for non-resident pages
+	int *s_next, *s_prev; // stack S, head is the top
+	int *q_next, *q_prev; // queue Q or the ghost FIFO
+	unsigned char *status; // LIRS_LIR, LIRS_HIR or LIRS_NONRES
+	unsigned char *in_s;
+	int *free_nodes, nfree_nodes;
+	Node_List s, q, ghosts;
+	int lir_count;
+	int llirs; // frames for LIR pages
+	int lhirs; // frames for resident HIR pages, 1% of frames
+	int max_ghosts; // non-resident HIR pages remembered in S
+} Lirs;
+
+static size_t lirs_bytes(int frames)
+{
+	return sizeof(Lirs) + (size_t)(2 * frames + 1) * (7 * sizeof(int) + 2);
+}
+
+/* point the arrays into the allocation after the struct */
+static void lirs_layout(Lirs *l, int frames)
+{
+	int nodes = 2 * frames + 1;
+	int *p = (int *)(l + 1);
+	l->page = p; p += nodes;
+	l->frame = p; p += nodes;
+	l->s_next = p; p += nodes;
+	l->s_prev = p; p += nodes;
+	l->q_next = p; p += nodes;
+	l->q_prev = p; p += nodes;
+	l->free_nodes = p; p += nodes;
+	l->status = (unsigned char *)p;
+	l->in_s = l->status + nodes;
+}
+
+static Lirs *lirs_create(int frames)
+{
+	int nodes = 2 * frames + 1;
+	Lirs *l = malloc(lirs_bytes(frames));
+	int i = 0;
+	lirs_layout(l, frames);
+	for(i = 0; i < nodes; i++)
+		l->free_nodes[i] = nodes - 1 - i;
+	l->nfree_nodes = nodes;
+	node_list_init(&l->s);
+	node_list_init(&l->q);
+	node_list_init(&l->ghosts);
+	l->lir_count = 0;
+	l->lhirs = frames / 100 > 0 ? frames / 100 : 1;
+	l->llirs = frames - l->lhirs;
+	l->max_ghosts = frames;
+	return l;
+}
+
+static void lirs_init(Algorithm_Data *data)
+{
+	data->policy_state = lirs_create(data->page_table.size);
+}
+
+static size_t lirs_state_size(const Algorithm_Data *data)
+{
+	return lirs_bytes(data->page_table.size);
+}
+
+static void lirs_relink(Algorithm_Data *data)
+{
+	lirs_layout(data->policy_state, data->page_table.size);
+}
+
+static void lirs_forget(Algorithm_Data *data, Lirs *l, int n)
+{
+	page_map_del(&data->page_index, l->page[n]);
+	l->free_nodes[l->nfree_nodes++] = n;
+}
+
+/* drop HIR pages from the bottom of S until a LIR page is there */
+static void lirs_prune(Algorithm_Data *data, Lirs *l)
+{
+	int n = -1;
+	while((n = l->s.tail) != -1 && l->status[n] != LIRS_LIR)
+	{
+		node_list_remove(&l->s, l->s_next, l->s_prev, n);
+		l->in_s[n] = 0;
+		if(l->status[n] == LIRS_NONRES)
+		{
+			node_list_remove(&l->ghosts, l->q_next, l->q_prev, n);
+			lirs_forget(data, l, n);
+		}
+	}
+}
+
+/*
+ * turn n (already on top of S) into a LIR page; if that leaves too many,
+ * the LIR page at the bottom of S becomes a resident HIR page
+ */
+static void lirs_make_lir(Algorithm_Data *data, Lirs *l, int n)
+{
+	int b = -1;
+	if(l->llirs == 0)
+	{ // single frame, there is no room for LIR pages
+		l->status[n] = LIRS_HIR;
+		node_list_push_head(&l->q, l->q_next, l->q_prev, n);
+		return;
+	}
+	l->status[n] = LIRS_LIR;
+	if(++l->lir_count <= l->llirs)
+		return;
+	b = l->s.tail;
+	node_list_remove(&l->s, l->s_next, l->s_prev, b);
+	l->in_s[b] = 0;
+	l->status[b] = LIRS_HIR;
+	node_list_push_head(&l->q, l->q_next, l->q_prev, b);
+	l->lir_count--;
+	lirs_prune(data, l);
+}
+
+/*
+ * free a frame: evict the oldest resident HIR page, it stays in S as a
+ * non-resident page if its recency is still interesting
+ */
+static int lirs_reclaim(Algorithm_Data *data, Lirs *l)
+{
+	Frame_Table *ft = &data->page_table;
+	int n = -1, frame = -1;
+	if(ft->used < ft->size)
+		return ft->used++;
+	n = node_list_pop_tail(&l->q, l->q_next, l->q_prev);
+	frame = l->frame[n];
+	add_victim(data, frame);
+	l->frame[n] = -1;
+	if(l->in_s[n])
+	{
+		l->status[n] = LIRS_NONRES;
+		node_list_push_head(&l->ghosts, l->q_next, l->q_prev, n);
+		if(l->ghosts.len > l->max_ghosts)
+		{
+			n = node_list_pop_tail(&l->ghosts, l->q_next, l->q_prev);
+			node_list_remove(&l->s, l->s_next, l->s_prev, n);
+			l->in_s[n] = 0;
+			lirs_forget(data, l, n);
+		}
+	}
+	else
+		lirs_forget(data, l, n);
+	return frame;
+}
+
+/**
+ * int LIRS(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * LIRS Page Replacement Algorithm
+ *
+ * Ranks pages by inter-reference recency instead of recency: only pages
+ * re-referenced within the span of the LIR set become LIR, everything
+ * else competes for the 1% of frames given to HIR pages, so scans and
+ * one-off references cannot flush the working set.
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int LIRS(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        Lirs *l = data->policy_state;
+        int node = -1,
+            framep = -1;
+        int fault = 0;
+
+
+        node = page_map_get(&data->page_index, page_ref);
+        if(node != -1 && l->status[node] == LIRS_LIR)
+        { // Hit on a LIR page
+                int bottom = l->s.tail == node;
+                node_list_move_head(&l->s, l->s_next, l->s_prev, node);
+                if(bottom)
+                        lirs_prune(data, l);
+                ft->tick[l->frame[node]] = data->total_ref_count;
+        }
+        else if(node != -1 && l->status[node] == LIRS_HIR)
+        { // Hit on a resident HIR page, in S its recency beats the bottom LIR
+                node_list_remove(&l->q, l->q_next, l->q_prev, node);
+                if(l->in_s[node])
+                {
+                        node_list_move_head(&l->s, l->s_next, l->s_prev, node);
+                        lirs_make_lir(data, l, node);
+                }
+                else
+                {
+                        node_list_push_head(&l->s, l->s_next, l->s_prev, node);
+                        l->in_s[node] = 1;
+                        node_list_push_head(&l->q, l->q_next, l->q_prev, node);
+                }
+                ft->tick[l->frame[node]] = data->total_ref_count;
+        }
+        else
+        {
+                framep = lirs_reclaim(data, l);
+                // look again, reclaiming may have dropped the ghost entry
+                node = page_map_get(&data->page_index, page_ref);
+                if(node != -1)
+                { // non-resident HIR page still in S
+                        node_list_remove(&l->ghosts, l->q_next, l->q_prev, node);
+                        node_list_move_head(&l->s, l->s_next, l->s_prev, node);
+                        lirs_make_lir(data, l, node);
+                }
+                else
+                {
+                        node = l->free_nodes[--l->nfree_nodes];
+                        l->page[node] = page_ref;
+                        page_map_put(&data->page_index, page_ref, node);
+                        node_list_push_head(&l->s, l->s_next, l->s_prev, node);
+                        l->in_s[node] = 1;
+                        if(l->lir_count < l->llirs)
+                        { // still filling the LIR set
+                                l->status[node] = LIRS_LIR;
+                                l->lir_count++;
+                        }
+                        else
+                        {
+                                l->status[node] = LIRS_HIR;
+                                node_list_push_head(&l->q, l->q_next, l->q_prev, node);
+                        }
+                }
+                l->frame[node] = framep;
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                ft->extra[framep] = l->status[node];
+                fault = 1;
+        }
+
+        return fault;
+}
+
+REGISTER_POLICY(two_q, TWO_Q, .label = "TWO_Q", .alias = "2Q", .order = 13,
+		.init = two_q_init, .state_size = two_q_state_size, .relink = two_q_relink)
+REGISTER_POLICY(lirs, LIRS, .label = "LIRS", .order = 14,
+		.init = lirs_init, .state_size = lirs_state_size, .relink = lirs_relink)
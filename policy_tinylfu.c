@@ -0,0 +1,184 @@
+/*
+   Page Replacement Algorithms: W-TinyLFU
+   Description: LRU window and SLRU main region with admission by a
+   Count-Min frequency sketch (count_min.c).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "node_list.h"
+#include "count_min.h"
+#include "policy.h"
+
+/*
+ * W-TinyLFU state (Einziger, Friedman & Manes, ACM ToS 2017). A small LRU
+ * window admits every new page; when it overflows, its LRU page only gets
+ * into the SLRU main region (probation + protected) if the sketch says it
+ * is referenced more often than main's victim. Lists are linked through
+ * frame numbers, the frame's extra field says which one it is on.
+ */
+enum { WTLFU_WINDOW, WTLFU_PROBATION, WTLFU_PROTECTED };
+
+typedef struct W_Tinylfu
+{
+	int *next, *prev;
+	Node_List window, probation, protected;
+	int window_max; // 1% of frames
+	int protected_max; // 80% of the main region
+	Count_Min sketch;
+} W_Tinylfu;
+
+static size_t w_tinylfu_bytes(int frames)
+{
+	return sizeof(W_Tinylfu) + sizeof(uint64_t) * count_min_words(frames) + sizeof(int) * (size_t)(2 * frames);
+}
+
+static W_Tinylfu *w_tinylfu_create(int frames)
+{
+	size_t words = count_min_words(frames);
+	W_Tinylfu *w = malloc(w_tinylfu_bytes(frames));
+	uint64_t *sketch = (uint64_t *)(w + 1);
+	w->next = (int *)(sketch + words);
+	w->prev = w->next + frames;
+	node_list_init(&w->window);
+	node_list_init(&w->probation);
+	node_list_init(&w->protected);
+	w->window_max = frames / 100 > 0 ? frames / 100 : 1;
+	w->protected_max = (frames - w->window_max) * 8 / 10;
+	count_min_init(&w->sketch, frames, sketch);
+	return w;
+}
+
+static void w_tinylfu_init(Algorithm_Data *data)
+{
+	data->policy_state = w_tinylfu_create(data->page_table.size);
+}
+
+static size_t w_tinylfu_state_size(const Algorithm_Data *data)
+{
+	return w_tinylfu_bytes(data->page_table.size);
+}
+
+/* point the links and the sketch back into the allocation after a copy */
+static void w_tinylfu_relink(Algorithm_Data *data)
+{
+	W_Tinylfu *w = data->policy_state;
+	int frames = data->page_table.size;
+	uint64_t *sketch = (uint64_t *)(w + 1);
+	w->next = (int *)(sketch + count_min_words(frames));
+	w->prev = w->next + frames;
+	count_min_attach(&w->sketch, frames, sketch);
+}
+
+/* move frame f to the MRU end of list l */
+static void w_tinylfu_push(W_Tinylfu *w, Frame_Table *ft, Node_List *l, int seg, int f)
+{
+	node_list_push_head(l, w->next, w->prev, f);
+	ft->extra[f] = seg;
+}
+
+/*
+ * free a frame: the window's LRU page and main's victim compete on
+ * estimated frequency, the loser is evicted
+ */
+static int w_tinylfu_evict(Algorithm_Data *data, W_Tinylfu *w)
+{
+	Frame_Table *ft = &data->page_table;
+	Node_List *main_list = w->probation.len > 0 ? &w->probation : &w->protected;
+	int candidate = w->window.len >= w->window_max ? w->window.tail : -1;
+	int victim = main_list->tail;
+	if(victim == -1 || (candidate != -1 &&
+			count_min_estimate(&w->sketch, ft->page[candidate]) >
+			count_min_estimate(&w->sketch, ft->page[victim])))
+	{ // candidate is admitted, or there is no main region to admit it to
+		if(victim != -1)
+		{
+			node_list_remove(&w->window, w->next, w->prev, candidate);
+			w_tinylfu_push(w, ft, &w->probation, WTLFU_PROBATION, candidate);
+			node_list_remove(main_list, w->next, w->prev, victim);
+		}
+		else
+		{
+			victim = candidate;
+			node_list_remove(&w->window, w->next, w->prev, victim);
+		}
+	}
+	else if(candidate != -1)
+	{ // main keeps its victim
+		victim = candidate;
+		node_list_remove(&w->window, w->next, w->prev, victim);
+	}
+	else
+		node_list_remove(main_list, w->next, w->prev, victim);
+	add_victim(data, victim);
+	page_map_del(&data->page_index, ft->page[victim]);
+	return victim;
+}
+
+/**
+ * int W_TINYLFU(Algorithm_Data *data, int page_ref, int is_write)
+ *
+ * W-TinyLFU Page Replacement Algorithm
+ *
+ * LRU window in front of a segmented LRU, with admission to the SLRU
+ * decided by a fixed size frequency sketch instead of exact per page
+ * counts, so memory does not grow with the trace.
+ *
+ * @param *data {Algorithm_Data} struct holding algorithm data
+ * @param page_ref {int} referenced page number
+ * @param is_write {int} 1 if the reference is a store
+ *
+ * return {int} did page fault, 0 or 1
+ */
+static int W_TINYLFU(Algorithm_Data *data, int page_ref, int is_write)
+{
+        Frame_Table *ft = &data->page_table;
+        W_Tinylfu *w = data->policy_state;
+        int framep = -1;
+        int fault = 0;
+
+
+        count_min_increment(&w->sketch, page_ref);
+        framep = page_map_get(&data->page_index, page_ref);
+        if(framep != -1)
+        { // The page was found! Hit!
+                if(ft->extra[framep] == WTLFU_WINDOW)
+                        node_list_move_head(&w->window, w->next, w->prev, framep);
+                else if(ft->extra[framep] == WTLFU_PROTECTED)
+                        node_list_move_head(&w->protected, w->next, w->prev, framep);
+                else
+                { // second hit in main, protect it and demote protected's LRU
+                        node_list_remove(&w->probation, w->next, w->prev, framep);
+                        w_tinylfu_push(w, ft, &w->protected, WTLFU_PROTECTED, framep);
+                        if(w->protected.len > w->protected_max)
+                        {
+                                int d = node_list_pop_tail(&w->protected, w->next, w->prev);
+                                w_tinylfu_push(w, ft, &w->probation, WTLFU_PROBATION, d);
+                        }
+                }
+                ft->tick[framep] = data->total_ref_count;
+        }
+        else
+        {
+                if(ft->used < ft->size)
+                {
+                        framep = ft->used++;
+                        if(w->window.len >= w->window_max)
+                        { // room left in main, the window's LRU page moves there
+                                int d = node_list_pop_tail(&w->window, w->next, w->prev);
+                                w_tinylfu_push(w, ft, &w->probation, WTLFU_PROBATION, d);
+                        }
+                }
+                else
+                        framep = w_tinylfu_evict(data, w);
+                w_tinylfu_push(w, ft, &w->window, WTLFU_WINDOW, framep);
+                ft->page[framep] = page_ref;
+                ft->tick[framep] = data->total_ref_count;
+                page_map_put(&data->page_index, page_ref, framep);
+                fault = 1;
+        }
+
+        return fault;
+}
+
+REGISTER_POLICY(w_tinylfu, W_TINYLFU, .label = "W_TINYLFU", .alias = "TINYLFU", .order = 17,
+		.init = w_tinylfu_init, .state_size = w_tinylfu_state_size, .relink = w_tinylfu_relink)
@@ -0,0 +1,255 @@
+/*
+   Prefetch
+   Description: sequential, stride and adaptive readahead between the
+   trace and a policy. See prefetch.h.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "prefetch.h"
+
+int prefetch_mode(const char *name)
+{
+	if(strcmp(name, "next") == 0)
+		return PREFETCH_NEXT;
+	if(strcmp(name, "stride") == 0)
+		return PREFETCH_STRIDE;
+	if(strcmp(name, "adaptive") == 0)
+		return PREFETCH_ADAPTIVE;
+	return -1;
+}
+
+/**
+ * Prefetcher *prefetch_create(int mode, int degree, int pages, const Page_Ids *ids)
+ *
+ * @param degree {int} N, pages ahead of a miss or strides ahead of a stream
+ * @param pages {int} page ids are below pages
+ * @param ids {const Page_Ids*} ids of a renumbered trace, NULL if the page numbers are the trace's
+ *
+ * @return the prefetcher, NULL if out of memory
+ */
+Prefetcher *prefetch_create(int mode, int degree, int pages, const Page_Ids *ids)
+{
+	Prefetcher *pf = calloc(1, sizeof(Prefetcher)); // streams with window 0 are free
+	if(pf == NULL)
+		return NULL;
+	pf->pending = bitmap_alloc(pages > 0 ? pages : 1);
+	pf->resident = bitmap_alloc(pages > 0 ? pages : 1);
+	if(pf->pending == NULL || pf->resident == NULL)
+	{
+		free(pf->pending);
+		free(pf->resident);
+		free(pf);
+		return NULL;
+	}
+	pf->mode = mode;
+	pf->degree = degree > 0 ? degree : 1;
+	pf->pages = pages;
+	pf->ids = ids;
+	return pf;
+}
+
+void prefetch_free(Prefetcher *pf)
+{
+	if(pf == NULL)
+		return;
+	free(pf->pending);
+	free(pf->resident);
+	free(pf);
+}
+
+static int64_t original_page(const Prefetcher *pf, int page)
+{
+	return pf->ids != NULL ? (int64_t)pf->ids->pages[page] : page;
+}
+
+/*
+ * id of original page x, -1 if the trace doesn't have it, -2 if no page
+ * can be there
+ */
+static int page_id(const Prefetcher *pf, int64_t x)
+{
+	if(x < 0)
+		return -2;
+	if(pf->ids != NULL)
+		return page_ids_find(pf->ids, (uint64_t)x);
+	return x < pf->pages ? (int)x : -2;
+}
+
+/*
+ * bring original page x in through the policy, unless it's resident
+ */
+static void prefetch_page(Prefetcher *pf, Algorithm_Data *data, Access_Fn access, int64_t x)
+{
+	int page = page_id(pf, x);
+	if(page == -2)
+		return;
+	if(page == -1)
+	{ // read for nothing, no frame in the simulation
+		pf->issued++;
+		pf->absent++;
+		pf->wasted++;
+		return;
+	}
+	if(bitmap_test(pf->resident, page))
+		return;
+	pf->issued++;
+	access(data, page, 0);
+	bitmap_set(pf->resident, page);
+	bitmap_set(pf->pending, page);
+}
+
+/*
+ * strides of s from page a to page b, negative if b is behind a
+ */
+static inline int64_t strides(const Prefetch_Stream *s, int64_t a, int64_t b)
+{
+	return (b - a) / s->stride;
+}
+
+/*
+ * the stream page p continues. Otherwise the nearest stream learns a
+ * new stride from it, or the stream seen longest ago starts over at it.
+ */
+static Prefetch_Stream *stream_of(Prefetcher *pf, int64_t p, size_t now)
+{
+	Prefetch_Stream *s = NULL, *near = NULL, *oldest = &pf->streams[0];
+	int64_t d = 0, near_d = 0;
+	int i = 0;
+	for(i = 0; i < PREFETCH_STREAMS; i++)
+	{
+		s = &pf->streams[i];
+		if(s->seen < oldest->seen)
+			oldest = s;
+		if(s->window == 0)
+			continue;
+		d = p - s->last;
+		if(d == 0)
+			break; // same page again
+		if(d == s->stride)
+		{
+			s->confirmed = 1;
+			break;
+		}
+		if(llabs(d) <= PREFETCH_NEAR && (near == NULL || llabs(d) < llabs(near_d)))
+		{
+			near = s;
+			near_d = d;
+		}
+	}
+	if(i == PREFETCH_STREAMS)
+	{
+		s = near != NULL ? near : oldest;
+		s->stride = near != NULL ? (int)near_d : 0;
+		s->confirmed = 0;
+		s->ahead = s->marker = p;
+		s->window = pf->degree;
+	}
+	s->last = p;
+	s->seen = now;
+	return s;
+}
+
+/*
+ * adaptive batch: window strides past what the stream has already
+ * prefetched, the stream reaching its first page triggers the next one
+ */
+static void prefetch_batch(Prefetcher *pf, Prefetch_Stream *s, Algorithm_Data *data, Access_Fn access, int64_t p)
+{
+	int64_t start = strides(s, p, s->ahead) > 0 ? s->ahead : p;
+	int k = 0;
+	s->marker = start + s->stride;
+	for(k = 1; k <= s->window; k++)
+		prefetch_page(pf, data, access, start + (int64_t)k * s->stride);
+	s->ahead = start + (int64_t)s->window * s->stride;
+}
+
+/**
+ * void prefetch_ref(Prefetcher *pf, Algorithm_Data *data, Access_Fn access, int page, int fault)
+ *
+ * The prefetch stage, after the demand ref to page
+ *
+ * @param fault {int} whether the demand ref faulted
+ */
+void prefetch_ref(Prefetcher *pf, Algorithm_Data *data, Access_Fn access, int page, int fault)
+{
+	int used = bitmap_test(pf->pending, page);
+	int64_t p = original_page(pf, page), x = 0;
+	Prefetch_Stream *s = NULL;
+	int k = 0;
+	bitmap_set(pf->resident, page); // every policy loads a demand page
+	if(used)
+	{
+		bitmap_clear(pf->pending, page);
+		pf->useful++;
+	}
+	if(pf->mode == PREFETCH_NEXT)
+	{
+		if(fault || used)
+			for(k = 1; k <= pf->degree; k++)
+				prefetch_page(pf, data, access, p + k);
+		return;
+	}
+	s = stream_of(pf, p, data->total_ref_count);
+	if(!s->confirmed)
+		return;
+	if(pf->mode == PREFETCH_STRIDE)
+	{ // top up to window strides ahead, one page a ref once it's there
+		for(x = strides(s, p, s->ahead) > 0 ? s->ahead : p; strides(s, p, x + s->stride) <= s->window; )
+		{
+			x += s->stride;
+			prefetch_page(pf, data, access, x);
+			s->ahead = x;
+		}
+		return;
+	}
+	if(fault && strides(s, p, s->ahead) >= 0)
+	{ // prefetched for the stream but evicted before it got there
+		s->window = s->window > 1 ? s->window / 2 : 1;
+		prefetch_batch(pf, s, data, access, p);
+	}
+	else if(strides(s, p, s->ahead) < 0)
+		prefetch_batch(pf, s, data, access, p); // ran past the readahead, or just confirmed
+	else if(strides(s, s->marker, p) >= 0)
+	{ // reached the last batch, read the next one ahead at twice the size
+		if(used && s->window < PREFETCH_MAX_WINDOW)
+			s->window = s->window * 2 < PREFETCH_MAX_WINDOW ? s->window * 2 : PREFETCH_MAX_WINDOW;
+		prefetch_batch(pf, s, data, access, p);
+	}
+}
+
+/**
+ * size_t prefetch_replay(Prefetcher *pf, Algorithm_Data *data, Access_Fn access, const int *refs, size_t n, int count)
+ *
+ * Replay n refs like a policy's replay kernel, with the prefetch stage
+ * after each one
+ *
+ * @return demand faults
+ */
+size_t prefetch_replay(Prefetcher *pf, Algorithm_Data *data, Access_Fn access,
+		const int *refs, size_t n, int count)
+{
+	size_t i = 0, faults = 0;
+	int fault = 0;
+	for(i = 0; i < n; i++)
+	{
+		data->total_ref_count++;
+		fault = access(data, refs[i], 0);
+		prefetch_ref(pf, data, access, refs[i], fault);
+		faults += fault;
+	}
+	if(count)
+	{
+		data->misses += faults;
+		data->hits += n - faults;
+	}
+	return faults;
+}
+
+size_t prefetch_unused(const Prefetcher *pf)
+{
+	size_t n = 0;
+	int w = 0;
+	for(w = 0; w < (pf->pages + 63) / 64; w++)
+		n += __builtin_popcountll(pf->pending[w]);
+	return n;
+}
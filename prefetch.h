@@ -0,0 +1,89 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pagesim.h"
+#include "page_ids.h"
+#include "bitmap.h"
+
+/**
+ * Readahead in front of a policy. After each demand ref the prefetcher
+ * may bring in more pages through the policy's own access(), the same
+ * insertion a fault makes, without counting them as refs or bumping the
+ * policy's clock. Modes:
+ *
+ *  next      tagged sequential: on a miss, or on the first use of a
+ *            prefetched page, bring in the next N pages
+ *  stride    a table of PREFETCH_STREAMS streams learns each stream's
+ *            stride (up to PREFETCH_NEAR pages either way), and once a
+ *            stride repeats keeps the stream N strides ahead
+ *  adaptive  stride streams read ahead in batches, like the kernel's
+ *            readahead window: the first batch is N strides, and when
+ *            the stream reaches a batch the next one is issued at twice
+ *            the size, up to PREFETCH_MAX_WINDOW. A miss on a page the
+ *            stream had prefetched, evicted before it was used, halves it.
+ *
+ * A ref costs a scan of the fixed stream table plus the pages it
+ * prefetches, one per ref in steady state. Pages already resident are
+ * skipped, found in a bitmap the prefetcher keeps from the demand refs,
+ * its own inserts and prefetch_evicted(), not by searching the frames.
+ * A prefetched page is useful when referenced while resident, wasted
+ * when evicted first. With a renumbered trace streams follow the
+ * original page numbers, and a page the trace never references counts
+ * as wasted without taking a frame.
+ */
+enum { PREFETCH_OFF, PREFETCH_NEXT, PREFETCH_STRIDE, PREFETCH_ADAPTIVE };
+
+#define PREFETCH_STREAMS 16
+#define PREFETCH_NEAR 64 // largest stride a stream learns, in pages
+#define PREFETCH_MAX_WINDOW 32 // largest adaptive batch, in strides, the kernel's default 128K of 4K pages
+
+typedef int (*Access_Fn)(Algorithm_Data *data, int page_ref, int is_write);
+
+typedef struct Prefetch_Stream
+{
+	int64_t last; // last page of the stream
+	int64_t ahead; // furthest page prefetched for it
+	int64_t marker; // first page of the last adaptive batch
+	int stride; // pages from one ref to the next, 0 until it has two refs
+	int confirmed; // the stride repeated
+	int window; // strides to read ahead
+	size_t seen; // policy clock at its last ref, the oldest stream is replaced
+} Prefetch_Stream;
+
+typedef struct Prefetcher
+{
+	int mode;
+	int degree; // N
+	int pages; // page ids are below pages
+	const Page_Ids *ids; // renumbered trace: streams follow the original pages, NULL otherwise
+	Prefetch_Stream streams[PREFETCH_STREAMS];
+	uint64_t *pending; // bit per page: prefetched and not referenced yet
+	uint64_t *resident; // bit per page: in a frame
+	size_t issued, useful, wasted, absent; // absent: wasted on pages the trace doesn't have
+} Prefetcher;
+
+int prefetch_mode(const char *name); // PREFETCH_*, -1 if unknown
+Prefetcher *prefetch_create(int mode, int degree, int pages, const Page_Ids *ids); // NULL out of memory
+void prefetch_free(Prefetcher *pf);
+void prefetch_ref(Prefetcher *pf, Algorithm_Data *data, Access_Fn access, int page, int fault); // after a demand ref
+size_t prefetch_replay(Prefetcher *pf, Algorithm_Data *data, Access_Fn access,
+		const int *refs, size_t n, int count); // a replay kernel with the prefetch stage, returns faults
+size_t prefetch_unused(const Prefetcher *pf); // prefetched pages still waiting for a ref
+
+/*
+ * page is being evicted, a prefetch it was brought in by is wasted
+ */
+static inline void prefetch_evicted(Prefetcher *pf, int page)
+{
+	if(page < 0 || page >= pf->pages)
+		return;
+	bitmap_clear(pf->resident, page);
+	if(!bitmap_test(pf->pending, page))
+		return;
+	bitmap_clear(pf->pending, page);
+	pf->wasted++;
+}
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef REUSE_TREE_H
+#define REUSE_TREE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitmap.h"
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+/**
+ * LRU stack as an order statistic tree: a slot per page holding its last
+ * reference, slots in reference order. The live slots after a page's
+ * slot are the distinct pages referenced since, its reuse distance, and
+ * the slot with d live slots after it is the page at depth d of the
+ * stack. Live slots are bits and a Fenwick tree sums whole words of
+ * them, so the hot part is size/8 + size/16 bytes: a million pages stay
+ * in L2. The word being pushed into is left out of the tree until it
+ * fills, so a ref walks the tree twice, not three times. When the slots
+ * run out the live ones are compacted to the front, there are twice as
+ * many slots as pages so that happens at most every pages refs.
+ */
+typedef struct Reuse_Tree
+{
+	uint64_t *live_bits; // bit per slot, set while it's some page's last ref
+	int32_t *tree; // 1 based partial sums of the live bits per word, below next's word
+	int32_t *owner; // page in each slot, read when compacting or finding
+	int size, words, next, live;
+} Reuse_Tree;
+
+static inline int reuse_tree_init(Reuse_Tree *rt, int pages)
+{
+	memset(rt, 0, sizeof(*rt));
+	rt->words = pages > 32 ? (int)(((int64_t)pages * 2 + 63) / 64) : 1;
+	rt->size = rt->words * 64;
+	rt->live_bits = bitmap_alloc(rt->size);
+	rt->tree = calloc(rt->words + 1, sizeof(int32_t));
+	rt->owner = malloc(sizeof(int32_t) * rt->size);
+	if(rt->live_bits == NULL || rt->tree == NULL || rt->owner == NULL)
+		return -1;
+	return 0;
+}
+
+static inline void reuse_tree_free(Reuse_Tree *rt)
+{
+	free(rt->live_bits);
+	free(rt->tree);
+	free(rt->owner);
+	memset(rt, 0, sizeof(*rt));
+}
+
+static inline void reuse_tree_add(Reuse_Tree *rt, int w, int32_t v)
+{
+	for(w++; w <= rt->words; w += w & -w)
+		rt->tree[w] += v;
+}
+
+static inline int32_t reuse_tree_prefix(const Reuse_Tree *rt, int w) // live slots in words [0, w)
+{
+	int32_t sum = 0;
+	for(; w > 0; w -= w & -w)
+		sum += rt->tree[w];
+	return sum;
+}
+
+/*
+ * live slots after slot i, the reuse distance of its page
+ */
+static inline int32_t reuse_tree_after(const Reuse_Tree *rt, int i)
+{
+	uint64_t upto = ~(uint64_t)0 >> (63 - (i & 63)); // bits [0, i] of the word
+	return rt->live - reuse_tree_prefix(rt, i >> 6) - __builtin_popcountll(rt->live_bits[i >> 6] & upto);
+}
+
+static inline void reuse_tree_remove(Reuse_Tree *rt, int i)
+{
+	bitmap_clear(rt->live_bits, i);
+	if(i >> 6 != rt->next >> 6)
+		reuse_tree_add(rt, i >> 6, -1);
+	rt->live--;
+}
+
+/*
+ * make page the most recent, returns its slot. The caller compacts
+ * first if reuse_tree_full().
+ */
+static inline int reuse_tree_push(Reuse_Tree *rt, int page)
+{
+	int i = rt->next++;
+	rt->owner[i] = page;
+	bitmap_set(rt->live_bits, i);
+	rt->live++;
+	if((rt->next & 63) == 0) // the word filled up
+		reuse_tree_add(rt, (rt->next >> 6) - 1, __builtin_popcountll(rt->live_bits[(rt->next >> 6) - 1]));
+	return i;
+}
+
+static inline int reuse_tree_full(const Reuse_Tree *rt)
+{
+	return rt->next == rt->size;
+}
+
+/*
+ * position of the k-th set bit of w, k >= 1 and w has at least k
+ */
+static inline int reuse_tree_select(uint64_t w, int k)
+{
+#ifdef __BMI2__
+	return __builtin_ctzll(_pdep_u64((uint64_t)1 << (k - 1), w));
+#else
+	int pos = 0, half = 32, c = 0;
+	for(; half > 0; half >>= 1)
+	{
+		c = __builtin_popcountll(w & ((~(uint64_t)0) >> (64 - half)));
+		if(c < k)
+		{
+			k -= c;
+			w >>= half;
+			pos += half;
+		}
+	}
+	return pos;
+#endif
+}
+
+/*
+ * slot of the page at depth d of the stack, d < live: the one with d
+ * live slots after it
+ */
+static inline int reuse_tree_find(const Reuse_Tree *rt, int32_t d)
+{
+	int32_t k = rt->live - d; // it's the k-th live slot
+	int cur = rt->next >> 6, w = 0, step = 1;
+	int32_t in_tree = rt->live - (cur < rt->words ? __builtin_popcountll(rt->live_bits[cur]) : 0);
+	if(k > in_tree)
+		return cur * 64 + reuse_tree_select(rt->live_bits[cur], k - in_tree);
+	while(step * 2 <= rt->words)
+		step *= 2;
+	for(; step > 0; step >>= 1)
+	{ // the last word whose prefix is below k
+		if(w + step <= rt->words && rt->tree[w + step] < k)
+		{
+			w += step;
+			k -= rt->tree[w];
+		}
+	}
+	return w * 64 + reuse_tree_select(rt->live_bits[w], k);
+}
+
+/*
+ * slide the live slots down to 0..live-1, keeping their order, and
+ * rebuild the sums in O(size). The slot of page p is slot[p * stride],
+ * so it can live in the caller's per page struct.
+ */
+static inline void reuse_tree_compact(Reuse_Tree *rt, int32_t *slot, size_t stride)
+{
+	int w = 0, j = 0, up = 0;
+	for(w = 0; w < rt->words; w++)
+	{
+		uint64_t bits = rt->live_bits[w];
+		while(bits)
+		{
+			int i = w * 64 + __builtin_ctzll(bits);
+			bits &= bits - 1;
+			rt->owner[j] = rt->owner[i];
+			slot[(size_t)rt->owner[j] * stride] = j;
+			j++;
+		}
+	}
+	memset(rt->live_bits, 0, sizeof(uint64_t) * rt->words);
+	memset(rt->tree, 0, sizeof(int32_t) * (rt->words + 1));
+	for(w = 0; w < j; w++)
+		bitmap_set(rt->live_bits, w);
+	for(w = 1; w <= rt->words; w++)
+	{
+		if(w <= j >> 6)
+			rt->tree[w] += __builtin_popcountll(rt->live_bits[w - 1]);
+		up = w + (w & -w);
+		if(up <= rt->words)
+			rt->tree[up] += rt->tree[w];
+	}
+	rt->next = j;
+}
+
+#endif
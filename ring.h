@@ -0,0 +1,50 @@
+#ifndef RING_H
+#define RING_H
+
+/**
+ * Fixed capacity FIFO of ints in a caller supplied buffer. Pushing and
+ * popping only move an index, there is no allocation or linking.
+ */
+typedef struct Ring
+{
+	int *buf;
+	int cap;
+	int head; // slot of the oldest entry
+	int len;
+} Ring;
+
+static inline void ring_init(Ring *r, int *buf, int cap)
+{
+	r->buf = buf;
+	r->cap = cap;
+	r->head = 0;
+	r->len = 0;
+}
+
+/*
+ * append v as the newest entry, the ring must not be full;
+ * return the slot it was stored in
+ */
+static inline int ring_push(Ring *r, int v)
+{
+	int slot = r->head + r->len;
+	if(slot >= r->cap)
+		slot -= r->cap;
+	r->buf[slot] = v;
+	r->len++;
+	return slot;
+}
+
+/*
+ * remove and return the oldest entry, the ring must not be empty
+ */
+static inline int ring_pop(Ring *r)
+{
+	int v = r->buf[r->head];
+	if(++r->head == r->cap)
+		r->head = 0;
+	r->len--;
+	return v;
+}
+
+#endif
@@ -0,0 +1,126 @@
+#!/bin/bash
+
+# Throughput benchmark: every policy at 10, 1K and 64K frames on uniform,
+# hot/cold and Zipf traces, plus trace generation and loading (text and
+# binary). Writes ns per ref to bench/results.csv and compares it with
+# bench/baseline.csv, failing if anything got slower than the tolerance.
+#
+# ./run_bench.sh          run and compare with the baseline
+# ./run_bench.sh --save   run and store the results as the baseline
+#
+# BENCH_TIMEOUT   seconds a single run may take, default 10
+# BENCH_TOLERANCE percent slowdown allowed against the baseline, default 20
+# BENCH_POLICIES  policies to run, default all of them
+
+PAGESIM=./pagesim
+BENCH_DIR=bench
+RESULTS=${BENCH_DIR}/results.csv
+BASELINE=${BENCH_DIR}/baseline.csv
+TIMEOUT=${BENCH_TIMEOUT:-10}
+TOLERANCE=${BENCH_TOLERANCE:-20}
+POLICIES=${BENCH_POLICIES:-"OPTIMAL RANDOM FIFO LRU CLOCK NFU AGING LOG LOG_NOWIN LRU2 LRU3 SECOND_CHANCE CLOCK_PRO TWO_Q LIRS S3_FIFO SIEVE W_TINYLFU"}
+SEED=1
+mode=$1
+
+tmp=`mktemp -d`
+trap "rm -rf ${tmp}" EXIT
+
+# $1 = frames, $2 = workload, $3 = name, $4 = ns per ref or "timeout"
+function record()
+{
+	echo "$1,$2,$3,$4" >> ${RESULTS}
+	printf "%6s %-8s %-16s %s\n" "$1" "$2" "$3" "$4"
+}
+
+# ns per ref from a pagesim --timing "Trace:" line
+function trace_ns_per_ref()
+{
+	sed -n 's/^Trace: .*, \([0-9.]*\) ns\/ref$/\1/p'
+}
+
+# $1 = frames, $2 = -x multiplier (refs = frames * 2^x), $3 = workload name, rest = generator options
+function run_workload()
+{
+	frames=$1
+	multi=$2
+	workload=$3
+	shift 3
+
+	# generation, and the trace saved both ways for the load timings
+	ns=`${PAGESIM} -f ${frames} -x ${multi} "$@" --seed ${SEED} -a NONE --timing \
+		--save_trace ${tmp}/trace.bin 2>/dev/null | trace_ns_per_ref`
+	record ${frames} ${workload} gen ${ns}
+	${PAGESIM} -f ${frames} -t ${tmp}/trace.bin --seed ${SEED} -a NONE --save_trace ${tmp}/trace.txt \
+		> /dev/null 2>&1
+	for format in txt bin; do
+		ns=`${PAGESIM} -f ${frames} -t ${tmp}/trace.${format} --seed ${SEED} -a NONE --timing \
+			2>/dev/null | trace_ns_per_ref`
+		record ${frames} ${workload} load_${format} ${ns}
+	done
+
+	for policy in ${POLICIES}; do
+		rm -f ${tmp}/stats.csv
+		timeout ${TIMEOUT} ${PAGESIM} -f ${frames} -t ${tmp}/trace.bin --seed ${SEED} -a ${policy} \
+			--stats_file ${tmp}/stats.csv > /dev/null 2>&1
+		if [ -s ${tmp}/stats.csv ] ; then
+			# time_ns / refs
+			ns=`awk -F, 'NR == 2 { printf "%.2f", $7 / $3 }' ${tmp}/stats.csv`
+		else
+			ns=timeout
+		fi
+		record ${frames} ${workload} ${policy} ${ns}
+	done
+}
+
+# compare results with the baseline, 1 if anything is slower than the tolerance
+function compare()
+{
+	if [ ! -f ${BASELINE} ] ; then
+		echo "no ${BASELINE}, store one with: make bench_baseline"
+		return 0
+	fi
+	awk -F, -v tol=${TOLERANCE} '
+		NR == FNR { base[$1 "," $2 "," $3] = $4; next }
+		FNR == 1 { next }
+		{
+			key = $1 "," $2 "," $3
+			if(!(key in base))
+				next
+			if(base[key] == "timeout" || base[key] == 0)
+				status = "ok"
+			else if($4 == "timeout")
+				status = "SLOWER"
+			else
+				status = $4 > base[key] * (1 + tol / 100) ? "SLOWER" : "ok"
+			if(status != "ok")
+				failed = 1
+			printf "%6s %-8s %-16s %10s -> %10s %s\n", $1, $2, $3, base[key], $4, status
+		}
+		END { exit failed }' ${BASELINE} ${RESULTS}
+}
+
+if [ ! -x ${PAGESIM} ] ; then
+	echo "build ${PAGESIM} first"
+	exit 1
+fi
+
+mkdir -p ${BENCH_DIR}
+echo "frames,workload,name,ns_per_ref" > ${RESULTS}
+
+# about 256K refs per run
+for config in "10 15" "1024 8" "65536 2"; do
+	set -- ${config}
+	run_workload $1 $2 uniform
+	run_workload $1 $2 hotcold -h 20
+	run_workload $1 $2 zipf --zipf 0.99
+done
+
+if [ "${mode}" == "--save" ] ; then
+	cp ${RESULTS} ${BASELINE}
+	echo "baseline stored in ${BASELINE}"
+	exit 0
+fi
+
+echo
+echo "against ${BASELINE}, tolerance ${TOLERANCE}%:"
+compare
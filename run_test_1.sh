@@ -15,13 +15,11 @@ function run_test()
 		log_file=test1/pagesim_${ref_count}_${hotness}.log
 	fi
 
-for i in {1..10}; do
-	if [ -z ${hotness} ] ; then
-		./pagesim  -x ${multi} >> ${log_file}
-	else
-		./pagesim  -x ${multi} -h ${hotness} >> ${log_file}
-	fi
-done
+if [ -z ${hotness} ] ; then
+	./pagesim  -x ${multi} --repeat 10 >> ${log_file}
+else
+	./pagesim  -x ${multi} -h ${hotness} --repeat 10 >> ${log_file}
+fi
 
 
 }
@@ -12,9 +12,7 @@ function run_test()
 
 	log_file=test2/pagesim_${ref_count}_${hotness}_${window}.log
 
-for i in {1..10}; do
-		./pagesim  -x ${multi} -h ${hotness} -w ${window} >> ${log_file}
-done
+./pagesim  -x ${multi} -h ${hotness} -w ${window} --repeat 10 >> ${log_file}
 
 
 }
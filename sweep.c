@@ -0,0 +1,337 @@
+/*
+   Sweeps
+   Description: the --sweep grid, its --shard partition and merging the
+   result files of the shards. See sweep.h.
+ */
+#define _GNU_SOURCE // getline()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "sweep.h"
+
+static const char *dist_names[] = { "uniform", "head", "tail", "mid", "dual" };
+
+static int valid_dist(const char *d)
+{
+	size_t i = 0;
+	char *end = NULL;
+	for(i = 0; i < sizeof(dist_names) / sizeof(dist_names[0]); i++)
+		if(strcmp(d, dist_names[i]) == 0)
+			return 1;
+	if(strncmp(d, "zipf:", 5) != 0 || strtod(d + 5, &end) <= 0)
+		return 0;
+	return end != d + 5 && *end == '\0';
+}
+
+/*
+ * comma separated numbers >= min into values
+ */
+static int parse_ints(const char *key, const char *list, int *values, int *n, int min)
+{
+	const char *p = list;
+	char *end = NULL;
+	long v = 0;
+	for(*n = 0; *p != '\0'; p = *end == ',' ? end + 1 : end)
+	{
+		v = strtol(p, &end, 10);
+		if(end == p || v < min || v > INT_MAX || (*end != ',' && *end != '\0') || *n == SWEEP_MAX_VALUES)
+		{
+			fprintf(stderr, "[ERR] --sweep %s= takes up to %d numbers >= %d\n", key, SWEEP_MAX_VALUES, min);
+			return -1;
+		}
+		values[(*n)++] = (int)v;
+	}
+	if(*n == 0)
+	{
+		fprintf(stderr, "[ERR] --sweep %s= is empty\n", key);
+		return -1;
+	}
+	return 0;
+}
+
+static int parse_dists(const char *list, Sweep *sw)
+{
+	const char *p = list, *end = NULL;
+	size_t len = 0;
+	for(sw->num_dist = 0; *p != '\0'; p = *end == ',' ? end + 1 : end)
+	{
+		end = p + strcspn(p, ",");
+		len = end - p;
+		if(len >= SWEEP_DIST_LEN || sw->num_dist == SWEEP_MAX_VALUES)
+			break;
+		memcpy(sw->dist[sw->num_dist], p, len);
+		sw->dist[sw->num_dist][len] = '\0';
+		if(!valid_dist(sw->dist[sw->num_dist]))
+			break;
+		sw->num_dist++;
+	}
+	if(*p != '\0' || sw->num_dist == 0)
+	{
+		fprintf(stderr, "[ERR] --sweep dist= takes up to %d of uniform, head, tail, mid, dual and zipf:S\n",
+				SWEEP_MAX_VALUES);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * int sweep_parse(Sweep *sw, const char *spec, int frames, int hotness, int window, const char *dist)
+ *
+ * @param spec {const char*} "key=list;key=list...", keys f, h, w and dist
+ * @param frames, hotness, window, dist the command line's values, for the keys spec leaves out
+ *
+ * @return 0, -1 after a message
+ */
+int sweep_parse(Sweep *sw, const char *spec, int frames, int hotness, int window, const char *dist)
+{
+	char *copy = strdup(spec), *save = NULL, *item = NULL, *eq = NULL;
+	int err = 0, zipf = 0, i = 0;
+	memset(sw, 0, sizeof(*sw));
+	if(copy == NULL)
+		return -1;
+	for(item = strtok_r(copy, ";", &save); item != NULL && err == 0; item = strtok_r(NULL, ";", &save))
+	{
+		eq = strchr(item, '=');
+		if(eq != NULL)
+			*eq++ = '\0';
+		if(eq != NULL && strcmp(item, "f") == 0 && sw->num_frames == 0)
+			err = parse_ints("f", eq, sw->frames, &sw->num_frames, 1);
+		else if(eq != NULL && strcmp(item, "h") == 0 && sw->num_hotness == 0)
+			err = parse_ints("h", eq, sw->hotness, &sw->num_hotness, 0);
+		else if(eq != NULL && strcmp(item, "w") == 0 && sw->num_window == 0)
+			err = parse_ints("w", eq, sw->window, &sw->num_window, 0);
+		else if(eq != NULL && strcmp(item, "dist") == 0 && sw->num_dist == 0)
+			err = parse_dists(eq, sw);
+		else
+		{
+			fprintf(stderr, "[ERR] --sweep takes f=, h=, w= and dist= once each, not \"%s\"\n", item);
+			err = -1;
+		}
+	}
+	free(copy);
+	if(err != 0)
+		return -1;
+	if(sw->num_frames == 0)
+		sw->frames[sw->num_frames++] = frames;
+	if(sw->num_hotness == 0)
+		sw->hotness[sw->num_hotness++] = hotness;
+	if(sw->num_window == 0)
+		sw->window[sw->num_window++] = window;
+	if(sw->num_dist == 0)
+		snprintf(sw->dist[sw->num_dist++], SWEEP_DIST_LEN, "%s", dist);
+	sw->points = (long)sw->num_frames * sw->num_hotness * sw->num_window * sw->num_dist;
+	for(i = 0; i < sw->num_dist; i++)
+		zipf += strncmp(sw->dist[i], "zipf:", 5) == 0;
+	sw->runs = sw->points - (long)sw->num_frames * (sw->num_hotness - 1) * sw->num_window * zipf;
+	return 0;
+}
+
+/**
+ * int sweep_point(const Sweep *sw, long i, Sweep_Point *pt)
+ *
+ * Point i of the grid. Hotness doesn't apply to zipf, so a zipf point
+ * runs once, at the first hotness with h 0 (or the unset -1), and the
+ * points at the other hotness values repeat it.
+ *
+ * @return 1 if the point runs, 0 if it repeats another
+ */
+int sweep_point(const Sweep *sw, long i, Sweep_Point *pt)
+{
+	int h = 0;
+	pt->dist = sw->dist[i % sw->num_dist];
+	i /= sw->num_dist;
+	pt->window = sw->window[i % sw->num_window];
+	i /= sw->num_window;
+	h = i % sw->num_hotness;
+	pt->hotness = sw->hotness[h];
+	i /= sw->num_hotness;
+	pt->frames = sw->frames[i];
+	if(strncmp(pt->dist, "zipf:", 5) != 0)
+		return 1;
+	pt->hotness = sw->hotness[0] > 0 ? 0 : sw->hotness[0];
+	return h == 0;
+}
+
+int sweep_parse_shard(const char *s, int *index, int *count)
+{
+	char *end = NULL;
+	long i = strtol(s, &end, 10), n = 0;
+	if(end == s || *end != '/')
+		return -1;
+	s = end + 1;
+	n = strtol(s, &end, 10);
+	if(end == s || *end != '\0' || n < 1 || n > INT_MAX || i < 0 || i >= n)
+		return -1;
+	*index = (int)i;
+	*count = (int)n;
+	return 0;
+}
+
+typedef struct Sweep_Row
+{
+	long point;
+	int algo; // rank of its algorithm, in order of first appearance
+	size_t seq; // rows read before it, the last of a rerun wins
+	char *line;
+} Sweep_Row;
+
+static int row_order(const void *a, const void *b)
+{
+	const Sweep_Row *x = a, *y = b;
+	if(x->point != y->point)
+		return x->point < y->point ? -1 : 1;
+	if(x->algo != y->algo)
+		return x->algo < y->algo ? -1 : 1;
+	return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+/*
+ * rank of the algorithm in row's 6th field, adding it to names
+ */
+static int algo_rank(const char *line, char ***names, int *n)
+{
+	const char *p = line, *end = NULL;
+	int i = 0;
+	char **grown = NULL;
+	for(i = 0; i < 5 && p != NULL; i++)
+		p = strchr(p, ',') != NULL ? strchr(p, ',') + 1 : NULL;
+	if(p == NULL || (end = strchr(p, ',')) == NULL)
+		return -1;
+	for(i = 0; i < *n; i++)
+		if(strlen((*names)[i]) == (size_t)(end - p) && strncmp((*names)[i], p, end - p) == 0)
+			return i;
+	grown = realloc(*names, sizeof(char *) * (*n + 1));
+	if(grown == NULL)
+		return -1;
+	*names = grown;
+	(*names)[*n] = strndup(p, end - p);
+	return (*n)++;
+}
+
+/**
+ * int sweep_merge(FILE *out, char **paths, int n)
+ *
+ * Merge the result files of a sweep's shards into one, rows ordered by
+ * point and algorithm. A point and algorithm found twice is a rerun and
+ * the last file given wins, with a note if the results differ. A merge
+ * missing points (of the grid's runs, see sweep_point()) is written as
+ * shard "partial".
+ *
+ * @return 0, -1 after a message
+ */
+int sweep_merge(FILE *out, char **paths, int n)
+{
+	FILE *fp = NULL;
+	char *line = NULL, *header = NULL, *shared = NULL, **names = NULL;
+	size_t cap = 0, header_len = 0, rows_cap = 0, num_rows = 0, i = 0, kept = 0;
+	ssize_t len = 0;
+	long points = -1, covered = 0, last = -1;
+	int f = 0, num_names = 0, err = 0;
+	Sweep_Row *rows = NULL, *grown = NULL;
+	for(f = 0; f < n && err == 0; f++)
+	{
+		if((fp = fopen(paths[f], "r")) == NULL)
+		{
+			fprintf(stderr, "[ERR] cannot read %s\n", paths[f]);
+			err = -1;
+			break;
+		}
+		free(shared);
+		shared = NULL;
+		header_len = 0;
+		if(getline(&line, &cap, fp) < 0 || strcmp(line, SWEEP_MAGIC "\n") != 0)
+		{
+			fprintf(stderr, "[ERR] %s is not a pagesim sweep file\n", paths[f]);
+			err = -1;
+		}
+		while(err == 0 && (len = getline(&line, &cap, fp)) > 0 && line[0] == '#')
+		{ // the lines every shard shares, all but the shard
+			if(strncmp(line, "# shard:", 8) == 0)
+				continue;
+			if(strncmp(line, "# points:", 9) == 0)
+				points = atol(line + 9);
+			shared = realloc(shared, header_len + len + 1);
+			memcpy(shared + header_len, line, len + 1);
+			header_len += len;
+		}
+		if(err == 0 && (len <= 0 || shared == NULL || strcmp(line, SWEEP_COLUMNS "\n") != 0))
+		{
+			fprintf(stderr, "[ERR] %s has no " SWEEP_COLUMNS " rows\n", paths[f]);
+			err = -1;
+		}
+		else if(err == 0 && header != NULL && strcmp(header, shared) != 0)
+		{
+			fprintf(stderr, "[ERR] %s is from another sweep than %s (options, seed or grid differ)\n",
+					paths[f], paths[0]);
+			err = -1;
+		}
+		else if(err == 0 && header == NULL)
+		{
+			header = shared;
+			shared = NULL;
+		}
+		while(err == 0 && (len = getline(&line, &cap, fp)) > 0)
+		{
+			if(num_rows == rows_cap)
+			{
+				rows_cap = rows_cap ? rows_cap * 2 : 256;
+				grown = realloc(rows, sizeof(Sweep_Row) * rows_cap);
+				if(grown == NULL)
+				{
+					err = -1;
+					break;
+				}
+				rows = grown;
+			}
+			rows[num_rows].point = strtol(line, NULL, 10);
+			rows[num_rows].algo = algo_rank(line, &names, &num_names);
+			rows[num_rows].seq = num_rows;
+			rows[num_rows].line = strdup(line);
+			if(rows[num_rows].algo < 0 || rows[num_rows].point < 0 || rows[num_rows].line == NULL)
+			{
+				fprintf(stderr, "[ERR] %s: bad row %s", paths[f], line);
+				free(rows[num_rows].line);
+				err = -1;
+				break;
+			}
+			num_rows++;
+		}
+		fclose(fp);
+	}
+	if(err == 0)
+	{
+		qsort(rows, num_rows, sizeof(Sweep_Row), row_order);
+		for(i = 0; i < num_rows; i++)
+		{ // the last of equal rows is kept
+			if(i + 1 < num_rows && rows[i + 1].point == rows[i].point && rows[i + 1].algo == rows[i].algo)
+			{
+				if(strcmp(rows[i].line, rows[i + 1].line) != 0)
+					fprintf(stderr, ">>> point %ld %s differs between reruns, keeping the last\n",
+							rows[i].point, names[rows[i].algo]);
+				free(rows[i].line);
+				continue;
+			}
+			rows[kept++] = rows[i];
+			if(rows[i].point != last)
+				covered++;
+			last = rows[i].point;
+		}
+		if(covered < points)
+			fprintf(stderr, ">>> %ld of %ld points missing, the merge is partial\n", points - covered, points);
+		// the magic, the shared lines and the shard go back in the order a run writes them
+		fprintf(out, SWEEP_MAGIC "\n%s# shard: %s\n" SWEEP_COLUMNS "\n", header, covered < points ? "partial" : "0/1");
+		for(i = 0; i < kept; i++)
+			fputs(rows[i].line, out);
+	}
+	for(i = 0; i < (err == 0 ? kept : num_rows); i++)
+		free(rows[i].line);
+	for(f = 0; f < num_names; f++)
+		free(names[f]);
+	free(names);
+	free(rows);
+	free(line);
+	free(header);
+	free(shared);
+	return err;
+}
@@ -0,0 +1,49 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdio.h>
+
+/**
+ * A grid of runs for --sweep, "f=10,100;h=10,20;w=0,50;dist=uniform,zipf:0.9":
+ * frames, hotness (-h percent), window (-w) and distribution (uniform,
+ * head, tail, mid, dual or zipf:S), each a list, and a dimension left out
+ * keeps the command line's value. Every point runs the -a policies on
+ * the same seed. Hotness doesn't apply to zipf, whose points run once
+ * with h 0 and are left out at the other hotness values. Points are
+ * numbered frames first, distribution last, and --shard i/N runs the
+ * points whose number is i modulo N, so shards are fixed by the grid
+ * alone and spread its corners evenly.
+ *
+ * A result file is CSV after a header of "# " lines: SWEEP_MAGIC, the
+ * options, seed, grid and number of points every shard shares, then the
+ * shard. sweep_merge() checks the shared lines match and joins the rows,
+ * so a complete merge is byte for byte the file of a single --shard 0/1
+ * run.
+ */
+#define SWEEP_MAGIC "# pagesim sweep 1"
+#define SWEEP_MAX_VALUES 64 // per dimension
+#define SWEEP_DIST_LEN 24
+#define SWEEP_COLUMNS "point,frames,hotness,window,distribution,algorithm,hits,misses,hit_ratio"
+
+typedef struct Sweep
+{
+	int frames[SWEEP_MAX_VALUES], hotness[SWEEP_MAX_VALUES], window[SWEEP_MAX_VALUES];
+	char dist[SWEEP_MAX_VALUES][SWEEP_DIST_LEN];
+	int num_frames, num_hotness, num_window, num_dist;
+	long points; // the whole product, points are numbered below it
+	long runs; // the points that run, zipf ones once whatever the hotness
+} Sweep;
+
+typedef struct Sweep_Point
+{
+	int frames, hotness, window; // hotness and window -1 when not set
+	const char *dist;
+} Sweep_Point;
+
+int sweep_parse(Sweep *sw, const char *spec, int frames, int hotness, int window,
+		const char *dist); // the defaults fill dimensions the spec leaves out, 0 or -1 after a message
+int sweep_point(const Sweep *sw, long i, Sweep_Point *pt); // 1, 0 if point i repeats another
+int sweep_parse_shard(const char *s, int *index, int *count); // "i/N", 0 or -1
+int sweep_merge(FILE *out, char **paths, int n); // 0, -1 after a message
+
+#endif
@@ -0,0 +1,364 @@
+/*
+   Trace model
+   Description: fit a reuse distance model to a trace, save and load it,
+   and generate synthetic traces from it on several threads. See
+   trace_model.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "trace_model.h"
+#include "reuse_tree.h"
+
+#define MODEL_KINDS (MODEL_BUCKETS + 1) // the buckets, then first refs
+
+/*
+ * bucket of reuse distance d: d itself below 8, then 8 buckets per power
+ * of two, split by the 3 bits after the leading one
+ */
+static inline int model_bucket(uint32_t d)
+{
+	int e = 0;
+	if(d < 8)
+		return d;
+	e = 31 - __builtin_clz(d);
+	return 8 + (e - 3) * 8 + ((d >> (e - 3)) & 7);
+}
+
+static inline uint32_t model_bucket_lo(int b)
+{
+	if(b < 8)
+		return b;
+	return (uint32_t)(8 + (b - 8) % 8) << ((b - 8) / 8);
+}
+
+static inline uint32_t model_bucket_hi(int b)
+{
+	if(b < 8)
+		return b;
+	return model_bucket_lo(b) + (1u << ((b - 8) / 8)) - 1;
+}
+
+/**
+ * int trace_model_fit(Trace_Model *m, const int *refs, size_t n, int pages)
+ *
+ * Count the reuse distances of refs[0..n-1] into m
+ *
+ * @param pages {int} page numbers are below pages
+ * @return 0, -1 on allocation failure
+ */
+int trace_model_fit(Trace_Model *m, const int *refs, size_t n, int pages)
+{
+	Reuse_Tree rt;
+	int32_t *slot = malloc(sizeof(int32_t) * (pages > 0 ? pages : 1));
+	size_t t = 0;
+	int p = 0;
+	memset(m, 0, sizeof(*m));
+	if(reuse_tree_init(&rt, pages) != 0 || slot == NULL)
+	{
+		free(slot);
+		reuse_tree_free(&rt);
+		return -1;
+	}
+	for(p = 0; p < pages; p++)
+		slot[p] = -1;
+	for(t = 0; t < n; t++)
+	{
+		p = refs[t];
+		if(reuse_tree_full(&rt))
+			reuse_tree_compact(&rt, slot, 1);
+		if(slot[p] == -1)
+			m->cold++;
+		else
+		{
+			m->count[model_bucket(reuse_tree_after(&rt, slot[p]))]++;
+			reuse_tree_remove(&rt, slot[p]);
+		}
+		slot[p] = reuse_tree_push(&rt, p);
+	}
+	m->pages = (int)m->cold;
+	m->refs = n;
+	free(slot);
+	reuse_tree_free(&rt);
+	return 0;
+}
+
+/**
+ * int trace_model_save(const Trace_Model *m, const char *path)
+ *
+ * Write m as text: MODEL_MAGIC, "pages", "refs" and "cold" lines, then a
+ * "lo hi refs" line per reuse distance bucket that has refs
+ *
+ * @return 0, -1 on error
+ */
+int trace_model_save(const Trace_Model *m, const char *path)
+{
+	FILE *fp = fopen(path, "w");
+	int b = 0, ok = 1;
+	if(fp == NULL)
+	{
+		perror("trace_model_save()");
+		return -1;
+	}
+	ok = fprintf(fp, "%s\npages %d\nrefs %llu\ncold %llu\n# distance_lo distance_hi refs\n", MODEL_MAGIC,
+			m->pages, (unsigned long long)m->refs, (unsigned long long)m->cold) > 0;
+	for(b = 0; b < MODEL_BUCKETS && ok; b++)
+		if(m->count[b] > 0)
+			ok = fprintf(fp, "%u %u %llu\n", model_bucket_lo(b), model_bucket_hi(b),
+					(unsigned long long)m->count[b]) > 0;
+	if(fclose(fp) != 0 || !ok)
+	{
+		perror("trace_model_save()");
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * int trace_model_load(Trace_Model *m, const char *path)
+ *
+ * Read a model written by trace_model_save()
+ *
+ * @return 0, -1 with a message if it can't be read or doesn't add up
+ */
+int trace_model_load(Trace_Model *m, const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	char line[256];
+	unsigned long long a = 0, b = 0, c = 0, sum = 0;
+	int lines = 0, bad = 0, k = 0;
+	memset(m, 0, sizeof(*m));
+	if(fp == NULL)
+	{
+		perror("trace_model_load()");
+		return -1;
+	}
+	while(fgets(line, sizeof(line), fp) != NULL && !bad)
+	{
+		if(lines++ == 0)
+			bad = strncmp(line, MODEL_MAGIC, strlen(MODEL_MAGIC)) != 0;
+		else if(line[0] == '#' || line[0] == '\n')
+			continue;
+		else if(sscanf(line, "pages %llu", &a) == 1)
+		{
+			bad = a == 0 || a > INT32_MAX;
+			m->pages = bad ? 0 : (int)a;
+		}
+		else if(sscanf(line, "refs %llu", &a) == 1)
+			m->refs = a;
+		else if(sscanf(line, "cold %llu", &a) == 1)
+			m->cold = a;
+		else if(sscanf(line, "%llu %llu %llu", &a, &b, &c) == 3)
+		{
+			k = a < (1u << 31) ? model_bucket((uint32_t)a) : -1;
+			bad = k < 0 || model_bucket_lo(k) != a || model_bucket_hi(k) != b;
+			if(!bad)
+				m->count[k] += c;
+			sum += c;
+		}
+		else
+			bad = 1;
+	}
+	fclose(fp);
+	if(bad || m->pages == 0 || m->cold != (uint64_t)m->pages || sum + m->cold != m->refs)
+	{
+		fprintf(stderr, "[ERR] %s is not a pagesim trace model, or doesn't add up (line %d)\n", path, lines);
+		return -1;
+	}
+	for(k = 0; k < MODEL_BUCKETS; k++)
+		if(m->count[k] > 0 && model_bucket_lo(k) >= (uint32_t)m->pages)
+		{
+			fprintf(stderr, "[ERR] %s has reuse distances beyond its %d pages\n", path, m->pages);
+			return -1;
+		}
+	return 0;
+}
+
+/*
+ * xorshift64*, a generator per chunk so the trace doesn't depend on the
+ * number of threads
+ */
+static inline uint64_t model_next(uint64_t *s)
+{
+	*s ^= *s >> 12;
+	*s ^= *s << 25;
+	*s ^= *s >> 27;
+	return *s * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * Walker's alias table over the buckets and first refs, a draw is one
+ * random number whatever the number of buckets
+ */
+typedef struct Model_Alias
+{
+	double prob[MODEL_KINDS];
+	int alias[MODEL_KINDS];
+} Model_Alias;
+
+static void alias_build(Model_Alias *a, const Trace_Model *m)
+{
+	double p[MODEL_KINDS], total = (double)m->refs;
+	int small[MODEL_KINDS], large[MODEL_KINDS];
+	int ns = 0, nl = 0, i = 0, s = 0, l = 0;
+	for(i = 0; i < MODEL_KINDS; i++)
+	{
+		p[i] = (i < MODEL_BUCKETS ? m->count[i] : m->cold) * MODEL_KINDS / total;
+		a->alias[i] = i;
+		if(p[i] < 1)
+			small[ns++] = i;
+		else
+			large[nl++] = i;
+	}
+	while(ns > 0 && nl > 0)
+	{
+		s = small[--ns];
+		l = large[nl - 1];
+		a->prob[s] = p[s];
+		a->alias[s] = l;
+		p[l] -= 1 - p[s];
+		if(p[l] < 1)
+		{
+			nl--;
+			small[ns++] = l;
+		}
+	}
+	while(nl > 0)
+		a->prob[large[--nl]] = 1;
+	while(ns > 0) // rounding leftovers
+		a->prob[small[--ns]] = 1;
+}
+
+static inline int alias_draw(const Model_Alias *a, uint64_t r)
+{
+	int i = (int)(((r >> 32) * MODEL_KINDS) >> 32);
+	return (double)(uint32_t)r * (1.0 / 4294967296.0) < a->prob[i] ? i : a->alias[i];
+}
+
+typedef struct Model_Job
+{
+	const Trace_Model *m;
+	const Model_Alias *alias;
+	int *refs;
+	size_t n, chunk;
+	uint64_t seed;
+	atomic_size_t next; // next chunk to generate
+} Model_Job;
+
+/*
+ * chunk c of the refs from one LRU stack. The first chunk starts cold like the
+ * fitted trace, the others from every page in random order, so they
+ * don't have to wait for the ones before.
+ */
+static void gen_chunk(Model_Job *job, Reuse_Tree *rt, int32_t *slot, size_t c)
+{
+	const Trace_Model *m = job->m;
+	size_t i = c * job->chunk, to = i + job->chunk < job->n ? i + job->chunk : job->n;
+	uint64_t s = (job->seed + c + 1) * 0x9E3779B97F4A7C15ULL;
+	uint32_t d = 0;
+	int fresh = 0, page = 0, k = 0, j = 0;
+	s = s ? s : 1;
+	memset(rt->live_bits, 0, sizeof(uint64_t) * rt->words);
+	memset(rt->tree, 0, sizeof(int32_t) * (rt->words + 1));
+	rt->next = rt->live = 0;
+	for(page = 0; page < m->pages; page++)
+		slot[page] = -1;
+	if(c > 0)
+	{ // warm: a random permutation of the pages, pushed in order
+		for(page = 0; page < m->pages; page++)
+			rt->owner[page] = page;
+		for(page = m->pages - 1; page > 0; page--)
+		{
+			j = (int)(model_next(&s) % (page + 1));
+			k = rt->owner[page];
+			rt->owner[page] = rt->owner[j];
+			rt->owner[j] = k;
+		}
+		for(page = 0; page < m->pages; page++)
+			slot[rt->owner[page]] = reuse_tree_push(rt, rt->owner[page]);
+		fresh = m->pages;
+	}
+	for(; i < to; i++)
+	{
+		if(reuse_tree_full(rt))
+			reuse_tree_compact(rt, slot, 1);
+		k = alias_draw(job->alias, model_next(&s));
+		if(k < MODEL_BUCKETS)
+		{
+			d = model_bucket_lo(k);
+			if(model_bucket_hi(k) > d) // uniform in the bucket
+				d += (uint32_t)(((model_next(&s) >> 32) * (model_bucket_hi(k) - d + 1)) >> 32);
+		}
+		if(k == MODEL_BUCKETS || d >= (uint32_t)rt->live) // a first ref, the LRU page once all are in
+			page = fresh < m->pages ? fresh++ : rt->owner[reuse_tree_find(rt, rt->live - 1)];
+		else
+			page = rt->owner[reuse_tree_find(rt, d)];
+		if(slot[page] != -1)
+			reuse_tree_remove(rt, slot[page]);
+		slot[page] = reuse_tree_push(rt, page);
+		job->refs[i] = page;
+	}
+}
+
+static void *gen_worker(void *arg)
+{
+	Model_Job *job = arg;
+	Reuse_Tree rt;
+	int32_t *slot = malloc(sizeof(int32_t) * job->m->pages);
+	size_t c = 0, chunks = (job->n + job->chunk - 1) / job->chunk;
+	if(reuse_tree_init(&rt, job->m->pages) != 0 || slot == NULL)
+	{ // the other threads take its chunks
+		free(slot);
+		reuse_tree_free(&rt);
+		return NULL;
+	}
+	while((c = atomic_fetch_add(&job->next, 1)) < chunks)
+		gen_chunk(job, &rt, slot, c);
+	free(slot);
+	reuse_tree_free(&rt);
+	return NULL;
+}
+
+/**
+ * int trace_model_gen(const Trace_Model *m, int *refs, size_t n, uint64_t seed, int threads)
+ *
+ * Fill refs[0..n-1] with a trace drawn from m, in chunks of at least
+ * MODEL_CHUNK refs (16 times the pages for big models, to keep the warm
+ * start cheap) shared out to threads. Every chunk has its own generator
+ * seeded from seed and its number, so a seed gives the same trace
+ * whatever the threads.
+ *
+ * @return 0, -1 on allocation failure
+ */
+int trace_model_gen(const Trace_Model *m, int *refs, size_t n, uint64_t seed, int threads)
+{
+	Model_Alias alias;
+	Model_Job job;
+	pthread_t *tids = NULL;
+	size_t chunks = 0;
+	int i = 0, started = 0;
+	alias_build(&alias, m);
+	memset(&job, 0, sizeof(job));
+	job.m = m;
+	job.alias = &alias;
+	job.refs = refs;
+	job.n = n;
+	job.chunk = (size_t)m->pages * 16 > MODEL_CHUNK ? (size_t)m->pages * 16 : MODEL_CHUNK;
+	job.seed = seed;
+	atomic_init(&job.next, 0);
+	chunks = (n + job.chunk - 1) / job.chunk;
+	if((size_t)threads > chunks)
+		threads = (int)chunks;
+	tids = calloc(threads > 1 ? threads : 1, sizeof(pthread_t));
+	if(tids == NULL)
+		return -1;
+	for(i = 1; i < threads && pthread_create(&tids[started], NULL, gen_worker, &job) == 0; i++)
+		started++;
+	gen_worker(&job); // this thread works too
+	for(i = 0; i < started; i++)
+		pthread_join(tids[i], NULL);
+	free(tids);
+	return atomic_load(&job.next) < chunks ? -1 : 0; // every thread gave up
+}
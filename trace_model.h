@@ -0,0 +1,37 @@
+#ifndef TRACE_MODEL_H
+#define TRACE_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A few hundred numbers standing in for a trace: its distinct pages and
+ * how many of its refs had each reuse distance, in buckets of 1/8 of a
+ * power of two (exact below 8). Generating from it is Mattson's LRU stack
+ * model: each ref draws a distance and references the page that deep in
+ * the LRU stack, so a generated trace of any length has the LRU miss
+ * ratio curve of the fitted one. First refs keep their share too: once
+ * every page is in, they go to the bottom of the stack. Frequency based
+ * policies only see the skew the stack model implies, not the trace's
+ * own.
+ *
+ * The saved model is text, see trace_model_save().
+ */
+#define MODEL_MAGIC "# pagesim trace model 1"
+#define MODEL_BUCKETS 232 // covers distances below 2^31
+#define MODEL_CHUNK (1 << 22) // fewest refs generated from one stack
+
+typedef struct Trace_Model
+{
+	int pages; // distinct pages, generated ones are 0..pages-1
+	uint64_t refs; // refs of the fitted trace
+	uint64_t cold; // its first refs to a page
+	uint64_t count[MODEL_BUCKETS]; // its refs per reuse distance bucket, see model_bucket()
+} Trace_Model;
+
+int trace_model_fit(Trace_Model *m, const int *refs, size_t n, int pages); // 0, -1 out of memory
+int trace_model_save(const Trace_Model *m, const char *path); // 0, -1 on error
+int trace_model_load(Trace_Model *m, const char *path); // 0, -1 on error, after a message
+int trace_model_gen(const Trace_Model *m, int *refs, size_t n, uint64_t seed, int threads); // 0, -1 out of memory
+
+#endif
@@ -0,0 +1,439 @@
+/*
+   Trace statistics
+   Description: footprint, reuse distance, inter-reference gap and
+   hotness analysis of a page trace in one pass. See trace_stats.h.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "trace_stats.h"
+#include "reuse_tree.h"
+
+#define STATS_BUCKETS 64 // log2 buckets: 0, 1, 2-3, 4-7, ..., refs and gaps stay below 2^63
+#define STATS_PREFETCH 16 // refs ahead to fetch the page state of
+#define FOOTPRINT_POINTS 16
+#define STATS_MIN_CHUNK (1 << 16) // fewest refs worth a thread
+
+// per page state, together so a ref costs one cache miss
+typedef struct Page_Stat
+{
+	uint64_t last; // index of the last ref
+	uint64_t count;
+	int32_t slot; // -1 before the first ref
+} Page_Stat;
+
+// what the report is made of
+typedef struct Stats
+{
+	uint64_t dist_hist[STATS_BUCKETS], gap_hist[STATS_BUCKETS];
+	uint64_t cold, gap_sum, gap_max;
+	size_t fp_at[FOOTPRINT_POINTS], fp_pages[FOOTPRINT_POINTS]; // distinct pages after fp_at refs
+	int points;
+	uint64_t *count; // refs per page
+} Stats;
+
+// a first ref of a chunk, in order
+typedef struct Chunk_Ref
+{
+	int32_t page;
+	uint64_t t;
+} Chunk_Ref;
+
+// a page of a chunk, in order of its last ref there
+typedef struct Chunk_Page
+{
+	int32_t page;
+	uint64_t last, count;
+} Chunk_Page;
+
+// one thread's part of the trace, refs [lo, hi)
+typedef struct Chunk
+{
+	const int *refs;
+	size_t lo, hi;
+	int pages;
+	uint64_t dist_hist[STATS_BUCKETS], gap_hist[STATS_BUCKETS]; // of the reuses within it
+	uint64_t gap_sum, gap_max;
+	Chunk_Ref *first;
+	Chunk_Page *recent;
+	size_t distinct; // entries in first and recent
+	int err;
+	pthread_t tid;
+	int started;
+} Chunk;
+
+static inline int bucket(uint64_t v)
+{
+	return v ? 64 - __builtin_clzll(v) : 0;
+}
+
+static void bucket_label(int b, char *buf, size_t len)
+{
+	if(b == 0)
+		snprintf(buf, len, "0");
+	else if(b == 1)
+		snprintf(buf, len, "1");
+	else
+		snprintf(buf, len, "%llu-%llu", 1ULL << (b - 1), (1ULL << b) - 1);
+}
+
+static int cmp_desc(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/*
+ * pages that take pct of the refs, and the refs the hottest pct of pages take
+ */
+static void print_hotness(FILE *out, uint64_t *count, int pages, size_t n)
+{
+	static const double pcts[] = { 50, 80, 90, 95, 99 };
+	static const double top[] = { 1, 5, 10, 20, 50 };
+	uint64_t sum = 0;
+	int distinct = 0, i = 0, k = 0;
+	for(i = 0; i < pages; i++)
+		if(count[i] > 0)
+			count[distinct++] = count[i];
+	qsort(count, distinct, sizeof(uint64_t), cmp_desc);
+	fprintf(out, "Hotness:\n");
+	for(i = 0, k = 0; i < distinct && k < 5; i++)
+	{
+		sum += count[i];
+		while(k < 5 && sum * 100.0 >= pcts[k] * n)
+			fprintf(out, "  %2.0f%% of refs go to %d pages (%.2f%% of the footprint)\n",
+					pcts[k++], i + 1, 100.0 * (i + 1) / distinct);
+	}
+	for(k = 0, i = 0, sum = 0; k < 5; k++)
+	{
+		int upto = (int)(distinct * top[k] / 100);
+		for(; i < upto; i++)
+			sum += count[i];
+		fprintf(out, "  hottest %2.0f%% of pages (%d) take %.2f%% of refs\n", top[k], upto, n ? 100.0 * sum / n : 0.0);
+	}
+}
+
+/*
+ * the refs after which the footprint is reported: every n/16, and the
+ * end of the trace in place of the last one
+ */
+static int footprint_points(size_t n, size_t at[FOOTPRINT_POINTS])
+{
+	size_t step = n / FOOTPRINT_POINTS;
+	int k = 0;
+	if(n == 0)
+		return 0;
+	for(k = 0; step > 0 && k < FOOTPRINT_POINTS - 1; k++)
+		at[k] = step * (k + 1);
+	at[k++] = n;
+	return k;
+}
+
+/*
+ * the whole trace on one thread
+ */
+static int stats_serial(Stats *st, const int *refs, size_t n, int pages)
+{
+	Reuse_Tree rt;
+	Page_Stat *stat = malloc(sizeof(Page_Stat) * (pages > 0 ? pages : 1));
+	uint64_t gap = 0;
+	size_t t = 0;
+	Page_Stat *ps = NULL;
+	int p = 0, k = 0;
+	if(reuse_tree_init(&rt, pages) != 0 || stat == NULL)
+	{
+		free(stat);
+		reuse_tree_free(&rt);
+		return -1;
+	}
+	for(p = 0; p < pages; p++)
+	{
+		stat[p].count = 0;
+		stat[p].slot = -1;
+	}
+
+	for(t = 0; t < n; t++)
+	{
+		p = refs[t];
+		ps = &stat[p];
+		if(t + STATS_PREFETCH < n)
+			__builtin_prefetch(&stat[refs[t + STATS_PREFETCH]]);
+		if(reuse_tree_full(&rt))
+			reuse_tree_compact(&rt, &stat[0].slot, sizeof(Page_Stat) / sizeof(int32_t));
+		if(ps->slot == -1) // first ref
+			st->cold++;
+		else
+		{
+			st->dist_hist[bucket(reuse_tree_after(&rt, ps->slot))]++;
+			reuse_tree_remove(&rt, ps->slot);
+			gap = t - ps->last - 1;
+			st->gap_hist[bucket(gap)]++;
+			st->gap_sum += gap;
+			if(gap > st->gap_max)
+				st->gap_max = gap;
+		}
+		ps->slot = reuse_tree_push(&rt, p);
+		ps->last = t;
+		ps->count++;
+		if(k < st->points && t + 1 == st->fp_at[k])
+			st->fp_pages[k++] = rt.live;
+	}
+	reuse_tree_free(&rt);
+	st->count = (uint64_t *)stat; // counts packed over the per page state
+	for(p = 0; p < pages; p++)
+		st->count[p] = stat[p].count;
+	return 0;
+}
+
+/*
+ * thread: the reuses within a chunk, exactly as a serial pass finds them,
+ * plus its first refs, and its pages in LRU order with their last ref
+ */
+static void *chunk_pass(void *arg)
+{
+	Chunk *c = arg;
+	Reuse_Tree rt;
+	size_t cap = c->hi - c->lo < (size_t)c->pages ? c->hi - c->lo : (size_t)c->pages;
+	Page_Stat *stat = malloc(sizeof(Page_Stat) * c->pages), *ps = NULL;
+	uint64_t gap = 0;
+	size_t t = 0;
+	int p = 0, w = 0;
+	c->first = malloc(sizeof(Chunk_Ref) * cap);
+	c->recent = malloc(sizeof(Chunk_Page) * cap);
+	if(reuse_tree_init(&rt, (int)cap) != 0 || stat == NULL || c->first == NULL || c->recent == NULL)
+	{
+		c->err = -1;
+		free(stat);
+		reuse_tree_free(&rt);
+		return NULL;
+	}
+	for(p = 0; p < c->pages; p++)
+	{
+		stat[p].count = 0;
+		stat[p].slot = -1;
+	}
+	for(t = c->lo; t < c->hi; t++)
+	{
+		p = c->refs[t];
+		ps = &stat[p];
+		if(t + STATS_PREFETCH < c->hi)
+			__builtin_prefetch(&stat[c->refs[t + STATS_PREFETCH]]);
+		if(reuse_tree_full(&rt))
+			reuse_tree_compact(&rt, &stat[0].slot, sizeof(Page_Stat) / sizeof(int32_t));
+		if(ps->slot == -1)
+		{ // left for the merge, it knows what came before
+			c->first[c->distinct].page = p;
+			c->first[c->distinct++].t = t;
+		}
+		else
+		{
+			c->dist_hist[bucket(reuse_tree_after(&rt, ps->slot))]++;
+			reuse_tree_remove(&rt, ps->slot);
+			gap = t - ps->last - 1;
+			c->gap_hist[bucket(gap)]++;
+			c->gap_sum += gap;
+			if(gap > c->gap_max)
+				c->gap_max = gap;
+		}
+		ps->slot = reuse_tree_push(&rt, p);
+		ps->last = t;
+		ps->count++;
+	}
+	for(t = 0, w = 0; w < rt.words; w++)
+	{ // live slots oldest first: the chunk's pages by last ref
+		uint64_t bits = rt.live_bits[w];
+		while(bits)
+		{
+			p = rt.owner[w * 64 + __builtin_ctzll(bits)];
+			bits &= bits - 1;
+			c->recent[t].page = p;
+			c->recent[t].last = stat[p].last;
+			c->recent[t++].count = stat[p].count;
+		}
+	}
+	reuse_tree_free(&rt);
+	free(stat);
+	return NULL;
+}
+
+/*
+ * fold chunk c into the stack of the chunks before it: its first refs
+ * find their distances there, the stack seeing the chunk's earlier first
+ * refs on top just as the chunk had seen them, then its pages go on top
+ * in the order of their last refs, leaving the stack after the chunk
+ */
+static void merge_chunk(Stats *st, Reuse_Tree *rt, Page_Stat *stat, Chunk *c, int *k)
+{
+	Page_Stat *ps = NULL;
+	uint64_t gap = 0;
+	size_t i = 0;
+	int b = 0;
+	for(b = 0; b < STATS_BUCKETS; b++)
+	{
+		st->dist_hist[b] += c->dist_hist[b];
+		st->gap_hist[b] += c->gap_hist[b];
+	}
+	st->gap_sum += c->gap_sum;
+	if(c->gap_max > st->gap_max)
+		st->gap_max = c->gap_max;
+	for(i = 0; i < c->distinct; i++)
+	{
+		ps = &stat[c->first[i].page];
+		if(reuse_tree_full(rt))
+			reuse_tree_compact(rt, &stat[0].slot, sizeof(Page_Stat) / sizeof(int32_t));
+		if(ps->slot == -1)
+		{
+			while(*k < st->points && st->fp_at[*k] <= c->first[i].t)
+				st->fp_pages[(*k)++] = st->cold;
+			st->cold++;
+		}
+		else
+		{
+			st->dist_hist[bucket(reuse_tree_after(rt, ps->slot))]++;
+			reuse_tree_remove(rt, ps->slot);
+			gap = c->first[i].t - ps->last - 1;
+			st->gap_hist[bucket(gap)]++;
+			st->gap_sum += gap;
+			if(gap > st->gap_max)
+				st->gap_max = gap;
+		}
+		ps->slot = reuse_tree_push(rt, c->first[i].page);
+	}
+	for(i = 0; i < c->distinct; i++)
+	{
+		ps = &stat[c->recent[i].page];
+		if(reuse_tree_full(rt))
+			reuse_tree_compact(rt, &stat[0].slot, sizeof(Page_Stat) / sizeof(int32_t));
+		reuse_tree_remove(rt, ps->slot);
+		ps->slot = reuse_tree_push(rt, c->recent[i].page);
+		ps->last = c->recent[i].last;
+		st->count[c->recent[i].page] += c->recent[i].count;
+	}
+}
+
+/*
+ * PARDA style: the trace cut into a chunk per thread, each finding the
+ * reuse distances within it on its own stack, then the chunks folded in
+ * order into one stack, which resolves their first refs. Folding costs
+ * two stack operations per distinct page of each chunk, so it's a small
+ * serial part while the chunks are much longer than their footprints.
+ * Chunks are folded as their threads finish.
+ */
+static int stats_parallel(Stats *st, const int *refs, size_t n, int pages, int threads)
+{
+	Chunk *chunks = calloc(threads, sizeof(Chunk));
+	Reuse_Tree rt;
+	Page_Stat *stat = malloc(sizeof(Page_Stat) * pages);
+	int i = 0, k = 0, err = 0, p = 0;
+	st->count = calloc(pages, sizeof(uint64_t));
+	if(reuse_tree_init(&rt, pages) != 0 || chunks == NULL || stat == NULL || st->count == NULL)
+		err = -1;
+	for(i = 0; i < threads && err == 0; i++)
+	{
+		chunks[i].refs = refs;
+		chunks[i].lo = n / threads * i;
+		chunks[i].hi = i + 1 < threads ? n / threads * (i + 1) : n;
+		chunks[i].pages = pages;
+		if(i > 0)
+			chunks[i].started = pthread_create(&chunks[i].tid, NULL, chunk_pass, &chunks[i]) == 0;
+	}
+	for(p = 0; p < pages && err == 0; p++)
+		stat[p].slot = -1;
+	for(i = 0; i < threads && err == 0; i++)
+	{
+		if(chunks[i].started)
+			pthread_join(chunks[i].tid, NULL);
+		else
+			chunk_pass(&chunks[i]); // the first one, or one that didn't get a thread
+		chunks[i].started = 0;
+		err = chunks[i].err;
+		if(err == 0)
+			merge_chunk(st, &rt, stat, &chunks[i], &k);
+		free(chunks[i].first);
+		free(chunks[i].recent);
+	}
+	while(k < st->points)
+		st->fp_pages[k++] = st->cold;
+	for(i = 0; chunks != NULL && i < threads; i++)
+	{ // threads left running by an error
+		if(!chunks[i].started)
+			continue;
+		pthread_join(chunks[i].tid, NULL);
+		free(chunks[i].first);
+		free(chunks[i].recent);
+	}
+	reuse_tree_free(&rt);
+	free(stat);
+	free(chunks);
+	return err;
+}
+
+/**
+ * int trace_stats(FILE *out, const int *refs, size_t n, int pages, int threads)
+ *
+ * Analyze refs[0..n-1] and print the report to out. The report is the
+ * same for any number of threads.
+ *
+ * @param pages {int} page numbers are below pages
+ * @param threads {int} at most this many, fewer on a short trace
+ * @return 0, -1 on allocation failure
+ */
+int trace_stats(FILE *out, const int *refs, size_t n, int pages, int threads)
+{
+	Stats st;
+	uint64_t misses = 0;
+	int b = 0, dist_top = 0, gap_top = 0, err = 0;
+	char label[48];
+	memset(&st, 0, sizeof(st));
+	st.points = footprint_points(n, st.fp_at);
+	if(threads > 1 && n / threads < STATS_MIN_CHUNK)
+		threads = (int)(n / STATS_MIN_CHUNK);
+	if(threads > 1 && pages > 0)
+		err = stats_parallel(&st, refs, n, pages, threads);
+	else
+		err = stats_serial(&st, refs, n, pages);
+	if(err != 0)
+	{
+		free(st.count);
+		return -1;
+	}
+
+	fprintf(out, "Trace analysis: %zu refs, %llu distinct pages, %llu cold refs\n", n,
+			(unsigned long long)st.cold, (unsigned long long)st.cold);
+	fprintf(out, "Footprint:\n  %14s %14s\n", "refs", "pages");
+	for(b = 0; b < st.points; b++)
+		fprintf(out, "  %14zu %14zu\n", st.fp_at[b], st.fp_pages[b]);
+
+	for(b = 0; b < STATS_BUCKETS; b++)
+	{
+		if(st.dist_hist[b] > 0)
+			dist_top = b;
+		if(st.gap_hist[b] > 0)
+			gap_top = b;
+	}
+	fprintf(out, "Reuse distance (distinct pages in between), LRU miss ratio at 2^k frames:\n");
+	fprintf(out, "  %-24s %14s %8s %8s %14s\n", "distance", "refs", "%", "frames", "LRU miss ratio");
+	misses = n; // with 1 frame only distance 0 hits
+	for(b = 0; b <= dist_top; b++)
+	{
+		misses -= st.dist_hist[b]; // distance < 2^b hits with 2^b frames
+		bucket_label(b, label, sizeof(label));
+		fprintf(out, "  %-24s %14llu %8.3f %8llu %14.6f\n", label, (unsigned long long)st.dist_hist[b],
+				n ? 100.0 * st.dist_hist[b] / n : 0.0, 1ULL << b, n ? (double)misses / n : 0.0);
+	}
+	fprintf(out, "  %-24s %14llu %8.3f\n", "cold", (unsigned long long)st.cold, n ? 100.0 * st.cold / n : 0.0);
+
+	fprintf(out, "Inter-reference gap (refs in between): mean %.1f, max %llu\n",
+			n > st.cold ? (double)st.gap_sum / (n - st.cold) : 0.0, (unsigned long long)st.gap_max);
+	fprintf(out, "  %-24s %14s %8s\n", "gap", "refs", "%");
+	for(b = 0; b <= gap_top; b++)
+	{
+		bucket_label(b, label, sizeof(label));
+		fprintf(out, "  %-24s %14llu %8.3f\n", label, (unsigned long long)st.gap_hist[b],
+				n ? 100.0 * st.gap_hist[b] / n : 0.0);
+	}
+	print_hotness(out, st.count, pages, n);
+	free(st.count);
+	return 0;
+}
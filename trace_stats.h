@@ -0,0 +1,18 @@
+#ifndef TRACE_STATS_H
+#define TRACE_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * One pass trace analysis, for --analyze: footprint growth, reuse
+ * distance histogram with the LRU miss ratio curve it implies,
+ * inter-reference gaps and the hotness curve. Reuse distances come from
+ * a Reuse_Tree (reuse_tree.h), so memory is O(distinct pages) whatever
+ * the trace length. With threads the trace is cut into a chunk per
+ * thread, analyzed at once and stitched together in order (PARDA), which
+ * gives exactly the serial report at O(distinct pages) memory per thread.
+ */
+int trace_stats(FILE *out, const int *refs, size_t n, int pages, int threads); // refs are 0..pages-1, 0 on success
+
+#endif